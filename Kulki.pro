@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui
+QT       += core gui network
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -15,12 +15,65 @@ SOURCES += main.cpp\
         mainwindow.cpp \
     gamemap.cpp \
     game.cpp \
-    highscore.cpp
+    highscore.cpp \
+    gamepool.cpp \
+    batchevaluator.cpp \
+    protocol.cpp \
+    gameserver.cpp \
+    localclient.cpp \
+    headless.cpp \
+    player.cpp \
+    tournament.cpp \
+    puzzlesolver.cpp \
+    gamestatistics.cpp \
+    positiondatabase.cpp \
+    turnhistory.cpp \
+    sharedleaderboard.cpp \
+    animationscheduler.cpp \
+    differentialfuzzer.cpp \
+    featureextractor.cpp \
+    featurestore.cpp \
+    deadposition.cpp \
+    leaderboardmerge.cpp \
+    spectatorfeed.cpp
 
 HEADERS  += mainwindow.h \
     gamemap.h \
     game.h \
-    highscore.h
+    highscore.h \
+    rng.h \
+    rules.h \
+    gamepool.h \
+    batchevaluator.h \
+    protocol.h \
+    gameserver.h \
+    localclient.h \
+    headless.h \
+    player.h \
+    tournament.h \
+    puzzlesolver.h \
+    gamestatistics.h \
+    positiondatabase.h \
+    turnhistory.h \
+    sharedleaderboard.h \
+    animationscheduler.h \
+    differentialfuzzer.h \
+    featureextractor.h \
+    featurestore.h \
+    deadposition.h \
+    leaderboardmerge.h \
+    spectatorfeed.h
+
+# Batched board kernels use SSE2 on any x86-64 build; "qmake CONFIG+=avx2" widens them to AVX2
+avx2 {
+    QMAKE_CXXFLAGS += $$QMAKE_CFLAGS_AVX2
+}
+
+# FeatureExtractor's loops over 32 lanes are left to the auto-vectorizer, which GCC
+# only runs in full at -O3 or with -ftree-vectorize
+*-g++* {
+    QMAKE_CXXFLAGS_RELEASE += -ftree-vectorize
+}
 
 FORMS    += mainwindow.ui
 
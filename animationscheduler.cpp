@@ -0,0 +1,278 @@
+#include "animationscheduler.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace Qoolkie
+{
+
+constexpr int AnimationScheduler::FrameIntervalMs;
+constexpr int64_t AnimationScheduler::StepMs;
+constexpr int64_t AnimationScheduler::MaxMoveMs;
+constexpr int64_t AnimationScheduler::SpawnMs;
+constexpr int64_t AnimationScheduler::ClearMs;
+constexpr int64_t AnimationScheduler::MaxBacklogMs;
+constexpr uint8_t AnimationScheduler::MaxAnimations;
+constexpr uint8_t AnimationScheduler::BoardSize;
+constexpr uint8_t AnimationScheduler::TilesCount;
+
+namespace
+{
+
+constexpr int64_t NsPerMs {1000000};
+constexpr qreal SpawnStartScale {0.3};
+
+}
+
+AnimationScheduler::AnimationScheduler(QObject* parent) : QObject(parent)
+{
+    m_animations.reserve(MaxAnimations);
+    m_dirtyTiles.reserve(TilesCount);
+    m_isDirty.fill(false);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    m_timer.setInterval(FrameIntervalMs);
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(onFrame()));
+    m_clock.start();
+}
+
+void AnimationScheduler::reset()
+{
+    m_timer.stop();
+    m_animations.clear();
+    m_scheduled.fill(TileState {TileContent::None, false});
+    m_isDirty.fill(false);
+    m_dirtyTiles.clear();
+    m_phaseKind = AnimationKind::Move;
+    m_phaseStartMs = 0;
+    m_timelineEndMs = 0;
+    m_lastFrameNs = 0;
+}
+
+bool AnimationScheduler::isAnimating() const noexcept
+{
+    return !m_animations.empty();
+}
+
+const FrameStats& AnimationScheduler::getFrameStats() const noexcept
+{
+    return m_stats;
+}
+
+void AnimationScheduler::onBallMoved(TilePath path, TileContent content)
+{
+    if (path.empty())
+    {
+        return;
+    }
+    auto from = path.front();
+    auto dest = path.back();
+    m_scheduled[from.first * BoardSize + from.second] = TileState {TileContent::None, false};
+    m_scheduled[dest.first * BoardSize + dest.second] = TileState {content, false};
+
+    // Long detours walk faster so a single move never holds the board for long
+    int64_t durationMs = std::min(StepMs * static_cast<int64_t>(path.size() - 1U), MaxMoveMs);
+    schedule(Animation {AnimationKind::Move, content, false, dest.first, dest.second, 0U,
+                        beginPhase(AnimationKind::Move, durationMs), durationMs, std::move(path)});
+}
+
+void AnimationScheduler::onQoolkieGenerated(uint8_t x, uint8_t y, TileContent content)
+{
+    TileState& state = m_scheduled[x * BoardSize + y];
+    if (state.content == content && !state.isFocused)
+    {
+        return;
+    }
+    // Only a ball landing on an empty tile pops in, unfocusing or taking a ball away is instant
+    bool isSpawn = state.content == TileContent::None;
+    state = TileState {content, false};
+    int64_t durationMs = isSpawn ? SpawnMs : 0;
+    int64_t startMs = isSpawn ? beginPhase(AnimationKind::Show, durationMs) : -1;
+    schedule(Animation {AnimationKind::Show, content, false, x, y, 0U, startMs, durationMs, TilePath {}});
+}
+
+void AnimationScheduler::onFocusChanged(uint8_t x, uint8_t y, TileContent content)
+{
+    m_scheduled[x * BoardSize + y] = TileState {content, true};
+    schedule(Animation {AnimationKind::Show, content, true, x, y, 0U, -1, 0, TilePath {}});
+}
+
+void AnimationScheduler::onTileCleared(uint8_t x, uint8_t y)
+{
+    TileState& state = m_scheduled[x * BoardSize + y];
+    if (state.content == TileContent::None)
+    {
+        return;
+    }
+    TileContent content = state.content;
+    state = TileState {TileContent::None, false};
+    schedule(Animation {AnimationKind::Clear, content, false, x, y, 0U,
+                        beginPhase(AnimationKind::Clear, ClearMs), ClearMs, TilePath {}});
+}
+
+// Balls cleared or spawned by the same turn animate together; a move, or an effect
+// of another kind, waits until everything scheduled before it has played
+int64_t AnimationScheduler::beginPhase(AnimationKind kind, int64_t durationMs)
+{
+    int64_t nowMs = m_clock.elapsed();
+    if (m_timelineEndMs - nowMs > MaxBacklogMs || m_animations.size() >= MaxAnimations)
+    {
+        finishAll();
+        m_timelineEndMs = nowMs;
+    }
+    if (kind == AnimationKind::Move || kind != m_phaseKind || m_timelineEndMs <= nowMs)
+    {
+        m_phaseKind = kind;
+        m_phaseStartMs = std::max(nowMs, m_timelineEndMs);
+    }
+    m_timelineEndMs = std::max(m_timelineEndMs, m_phaseStartMs + durationMs);
+    return m_phaseStartMs;
+}
+
+void AnimationScheduler::schedule(Animation animation)
+{
+    int64_t nowMs = m_clock.elapsed();
+    if (animation.startMs < 0)
+    {
+        // Instant changes only wait for what is still playing on the same tile
+        animation.startMs = nowMs;
+        for (const Animation& scheduled : m_animations)
+        {
+            if (scheduled.x == animation.x && scheduled.y == animation.y)
+            {
+                animation.startMs = std::max(animation.startMs, scheduled.startMs + scheduled.durationMs);
+            }
+        }
+    }
+
+    if (m_animations.size() >= MaxAnimations)
+    {
+        finishAll();
+        animation.startMs = nowMs;
+        m_timelineEndMs = nowMs;
+    }
+    m_animations.push_back(std::move(animation));
+
+    if (!m_timer.isActive())
+    {
+        m_lastFrameNs = 0;
+        m_timer.start();
+    }
+}
+
+bool AnimationScheduler::advance(Animation& animation, int64_t nowMs)
+{
+    int64_t elapsedMs = nowMs - animation.startMs;
+    if (elapsedMs < 0)
+    {
+        return false;
+    }
+    bool isFinished = elapsedMs >= animation.durationMs;
+    qreal progress = isFinished ? 1.0 : static_cast<qreal>(elapsedMs) / animation.durationMs;
+
+    switch (animation.kind)
+    {
+    case AnimationKind::Move:
+    {
+        // Steps skipped by a late frame are never drawn
+        uint8_t lastStep = static_cast<uint8_t>(animation.path.size() - 1U);
+        uint8_t step = isFinished ? lastStep : static_cast<uint8_t>(elapsedMs * lastStep / animation.durationMs);
+        if (step != animation.step)
+        {
+            auto previous = animation.path[animation.step];
+            auto current = animation.path[step];
+            setFrame(previous.first, previous.second, TileContent::None, false, 1.0);
+            setFrame(current.first, current.second, animation.content, false, 1.0);
+            animation.step = step;
+        }
+        break;
+    }
+    case AnimationKind::Show:
+        setFrame(animation.x, animation.y, animation.content, animation.isFocused,
+                 SpawnStartScale + (1.0 - SpawnStartScale) * progress);
+        break;
+    case AnimationKind::Clear:
+        setFrame(animation.x, animation.y, isFinished ? TileContent::None : animation.content, false, 1.0 - progress);
+        break;
+    }
+    return isFinished;
+}
+
+void AnimationScheduler::setFrame(uint8_t x, uint8_t y, TileContent content, bool isFocused, qreal scale)
+{
+    uint8_t tileIdx = x * BoardSize + y;
+    m_frames[tileIdx] = TileFrame {content, isFocused, scale};
+    if (!m_isDirty[tileIdx])
+    {
+        m_isDirty[tileIdx] = true;
+        m_dirtyTiles.push_back(tileIdx);
+    }
+}
+
+void AnimationScheduler::flushFrames()
+{
+    for (uint8_t tileIdx : m_dirtyTiles)
+    {
+        const TileFrame& frame = m_frames[tileIdx];
+        m_isDirty[tileIdx] = false;
+        emit tileChanged(tileIdx / BoardSize, tileIdx % BoardSize, frame.content, frame.isFocused, frame.scale);
+    }
+    m_dirtyTiles.clear();
+}
+
+void AnimationScheduler::finishAll()
+{
+    int64_t endMs = std::numeric_limits<int64_t>::max();
+    for (Animation& animation : m_animations)
+    {
+        advance(animation, endMs);
+    }
+    m_animations.clear();
+    flushFrames();
+}
+
+void AnimationScheduler::onFrame()
+{
+    int64_t frameStartNs = m_clock.nsecsElapsed();
+    if (m_lastFrameNs != 0)
+    {
+        m_stats.lastIntervalNs = frameStartNs - m_lastFrameNs;
+        int64_t missed = m_stats.lastIntervalNs / (FrameIntervalMs * NsPerMs) - 1;
+        if (missed > 0)
+        {
+            m_stats.droppedFrames += missed;
+        }
+    }
+    m_lastFrameNs = frameStartNs;
+
+    // Animations are advanced and kept in the order they were scheduled, so the last one to
+    // touch a tile wins; the unfinished ones are moved down over the finished ones
+    int64_t nowMs = frameStartNs / NsPerMs;
+    size_t kept {0U};
+    for (size_t i = 0U; i < m_animations.size(); ++i)
+    {
+        if (!advance(m_animations[i], nowMs))
+        {
+            if (kept != i)
+            {
+                m_animations[kept] = std::move(m_animations[i]);
+            }
+            ++kept;
+        }
+    }
+    m_animations.erase(m_animations.begin() + kept, m_animations.end());
+    flushFrames();
+
+    if (m_animations.empty())
+    {
+        m_timer.stop();
+    }
+
+    m_stats.lastFrameNs = m_clock.nsecsElapsed() - frameStartNs;
+    m_stats.maxFrameNs = std::max(m_stats.maxFrameNs, m_stats.lastFrameNs);
+    m_totalFrameNs += m_stats.lastFrameNs;
+    ++m_stats.frames;
+    m_stats.meanFrameNs = m_totalFrameNs / static_cast<int64_t>(m_stats.frames);
+}
+
+}
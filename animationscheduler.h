@@ -0,0 +1,126 @@
+#ifndef ANIMATIONSCHEDULER_H
+#define ANIMATIONSCHEDULER_H
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+
+#include "gamemap.h"
+
+namespace Qoolkie
+{
+
+struct FrameStats
+{
+    uint64_t frames {0U};
+    uint64_t droppedFrames {0U};
+    int64_t lastFrameNs {0};
+    int64_t maxFrameNs {0};
+    int64_t meanFrameNs {0};
+    int64_t lastIntervalNs {0};
+};
+
+// Turns the Game signals into animations: a moved ball walks its shortest path,
+// spawned balls pop in and cleared lines shrink away. The Game state changes at
+// once, only the view catches up, so the next move can be made at any time.
+// Every active animation is advanced by one frame-paced timer and positioned from
+// the time elapsed, so a late frame jumps ahead instead of queueing. Tiles touched
+// in a frame are reported once. Once more than MaxBacklogMs is waiting to be
+// played, everything pending is completed at once, so quick successive moves
+// never fall behind and the number of animations a frame advances stays bounded.
+class AnimationScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int FrameIntervalMs {16};
+    static constexpr int64_t StepMs {35};
+    static constexpr int64_t MaxMoveMs {420};
+    static constexpr int64_t SpawnMs {140};
+    static constexpr int64_t ClearMs {160};
+    static constexpr int64_t MaxBacklogMs {1000};
+    static constexpr uint8_t MaxAnimations {128};
+
+    explicit AnimationScheduler(QObject* parent = nullptr);
+
+    void reset();
+    bool isAnimating() const noexcept;
+    const FrameStats& getFrameStats() const noexcept;
+
+signals:
+    void tileChanged(uint8_t x, uint8_t y, Qoolkie::TileContent content, bool isFocused, qreal scale);
+
+public slots:
+    void onBallMoved(Qoolkie::TilePath path, Qoolkie::TileContent content);
+    void onQoolkieGenerated(uint8_t x, uint8_t y, Qoolkie::TileContent content);
+    void onFocusChanged(uint8_t x, uint8_t y, Qoolkie::TileContent content);
+    void onTileCleared(uint8_t x, uint8_t y);
+
+private slots:
+    void onFrame();
+
+private:
+    static constexpr uint8_t BoardSize {GameMap::Rules::BoardSize};
+    static constexpr uint8_t TilesCount {BoardSize * BoardSize};
+
+    enum class AnimationKind : uint8_t
+    {
+        Move,
+        Show,
+        Clear
+    };
+
+    struct Animation
+    {
+        AnimationKind kind;
+        TileContent content;
+        bool isFocused;
+        uint8_t x;
+        uint8_t y;
+        uint8_t step;
+        int64_t startMs;
+        int64_t durationMs;
+        TilePath path;
+    };
+
+    struct TileState
+    {
+        TileContent content;
+        bool isFocused;
+    };
+
+    struct TileFrame
+    {
+        TileContent content;
+        bool isFocused;
+        qreal scale;
+    };
+
+    void schedule(Animation animation);
+    int64_t beginPhase(AnimationKind kind, int64_t durationMs);
+    bool advance(Animation& animation, int64_t nowMs);
+    void setFrame(uint8_t x, uint8_t y, TileContent content, bool isFocused, qreal scale);
+    void flushFrames();
+    void finishAll();
+
+    QTimer m_timer;
+    QElapsedTimer m_clock;
+    std::vector<Animation> m_animations;
+    std::array<TileState, TilesCount> m_scheduled;
+    std::array<TileFrame, TilesCount> m_frames;
+    std::array<bool, TilesCount> m_isDirty;
+    std::vector<uint8_t> m_dirtyTiles;
+    AnimationKind m_phaseKind {AnimationKind::Move};
+    int64_t m_phaseStartMs {0};
+    int64_t m_timelineEndMs {0};
+    int64_t m_lastFrameNs {0};
+    int64_t m_totalFrameNs {0};
+    FrameStats m_stats;
+};
+
+}
+
+#endif
@@ -0,0 +1,371 @@
+#include "batchevaluator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace Qoolkie
+{
+
+constexpr uint8_t BatchEvaluator::Lanes;
+constexpr uint8_t BatchEvaluator::MapRows;
+constexpr uint8_t BatchEvaluator::MapCols;
+constexpr uint8_t BatchEvaluator::MapTiles;
+
+namespace
+{
+
+// Lane primitives on 32 bytes. Every path computes exactly the same bytes, the
+// vector ones only do it in fewer instructions.
+#if defined(__AVX2__)
+
+constexpr char InstructionSet[] = "AVX2";
+
+inline void compareEqual(const uint8_t* a, const uint8_t* b, uint8_t* out) noexcept
+{
+    __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+    __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_cmpeq_epi8(va, vb));
+}
+
+inline void accumulateRun(const uint8_t* tile, const uint8_t* contents, uint8_t* active, uint8_t* count) noexcept
+{
+    __m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(tile)),
+                                   _mm256_loadu_si256(reinterpret_cast<const __m256i*>(contents)));
+    __m256i act = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(active)), eq);
+    __m256i cnt = _mm256_sub_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(count)), act);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(active), act);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(count), cnt);
+}
+
+inline void maxInto(uint8_t* dst, const uint8_t* src) noexcept
+{
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_max_epu8(a, b));
+}
+
+inline void andInto(uint8_t* dst, const uint8_t* src) noexcept
+{
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_and_si256(a, b));
+}
+
+inline bool spread(uint8_t* reached, const uint8_t* freeTiles, const uint8_t* n1, const uint8_t* n2,
+                   const uint8_t* n3, const uint8_t* n4) noexcept
+{
+    __m256i old = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(reached));
+    __m256i any = _mm256_or_si256(_mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(n1)),
+                                                  _mm256_loadu_si256(reinterpret_cast<const __m256i*>(n2))),
+                                  _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(n3)),
+                                                  _mm256_loadu_si256(reinterpret_cast<const __m256i*>(n4))));
+    __m256i now = _mm256_or_si256(old, _mm256_and_si256(any, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(freeTiles))));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(reached), now);
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi8(old, now)) != -1;
+}
+
+#elif defined(__SSE2__)
+
+constexpr char InstructionSet[] = "SSE2";
+
+inline __m128i load(const uint8_t* p, int half) noexcept
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + half * 16));
+}
+
+inline void store(uint8_t* p, int half, __m128i v) noexcept
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p + half * 16), v);
+}
+
+inline void compareEqual(const uint8_t* a, const uint8_t* b, uint8_t* out) noexcept
+{
+    for (int h = 0; h < 2; ++h)
+    {
+        store(out, h, _mm_cmpeq_epi8(load(a, h), load(b, h)));
+    }
+}
+
+inline void accumulateRun(const uint8_t* tile, const uint8_t* contents, uint8_t* active, uint8_t* count) noexcept
+{
+    for (int h = 0; h < 2; ++h)
+    {
+        __m128i act = _mm_and_si128(load(active, h), _mm_cmpeq_epi8(load(tile, h), load(contents, h)));
+        store(active, h, act);
+        store(count, h, _mm_sub_epi8(load(count, h), act));
+    }
+}
+
+inline void maxInto(uint8_t* dst, const uint8_t* src) noexcept
+{
+    for (int h = 0; h < 2; ++h)
+    {
+        store(dst, h, _mm_max_epu8(load(dst, h), load(src, h)));
+    }
+}
+
+inline void andInto(uint8_t* dst, const uint8_t* src) noexcept
+{
+    for (int h = 0; h < 2; ++h)
+    {
+        store(dst, h, _mm_and_si128(load(dst, h), load(src, h)));
+    }
+}
+
+inline bool spread(uint8_t* reached, const uint8_t* freeTiles, const uint8_t* n1, const uint8_t* n2,
+                   const uint8_t* n3, const uint8_t* n4) noexcept
+{
+    bool changed = false;
+    for (int h = 0; h < 2; ++h)
+    {
+        __m128i old = load(reached, h);
+        __m128i any = _mm_or_si128(_mm_or_si128(load(n1, h), load(n2, h)), _mm_or_si128(load(n3, h), load(n4, h)));
+        __m128i now = _mm_or_si128(old, _mm_and_si128(any, load(freeTiles, h)));
+        store(reached, h, now);
+        changed = changed || (_mm_movemask_epi8(_mm_cmpeq_epi8(old, now)) != 0xFFFF);
+    }
+    return changed;
+}
+
+#else
+
+constexpr char InstructionSet[] = "scalar";
+
+inline void compareEqual(const uint8_t* a, const uint8_t* b, uint8_t* out) noexcept
+{
+    for (uint8_t l = 0U; l < BatchEvaluator::Lanes; ++l)
+    {
+        out[l] = (a[l] == b[l]) ? 0xFF : 0x00;
+    }
+}
+
+inline void accumulateRun(const uint8_t* tile, const uint8_t* contents, uint8_t* active, uint8_t* count) noexcept
+{
+    for (uint8_t l = 0U; l < BatchEvaluator::Lanes; ++l)
+    {
+        active[l] &= (tile[l] == contents[l]) ? 0xFF : 0x00;
+        count[l] = static_cast<uint8_t>(count[l] + (active[l] & 1U));
+    }
+}
+
+inline void maxInto(uint8_t* dst, const uint8_t* src) noexcept
+{
+    for (uint8_t l = 0U; l < BatchEvaluator::Lanes; ++l)
+    {
+        dst[l] = std::max(dst[l], src[l]);
+    }
+}
+
+inline void andInto(uint8_t* dst, const uint8_t* src) noexcept
+{
+    for (uint8_t l = 0U; l < BatchEvaluator::Lanes; ++l)
+    {
+        dst[l] &= src[l];
+    }
+}
+
+inline bool spread(uint8_t* reached, const uint8_t* freeTiles, const uint8_t* n1, const uint8_t* n2,
+                   const uint8_t* n3, const uint8_t* n4) noexcept
+{
+    bool changed = false;
+    for (uint8_t l = 0U; l < BatchEvaluator::Lanes; ++l)
+    {
+        uint8_t now = reached[l] | ((n1[l] | n2[l] | n3[l] | n4[l]) & freeTiles[l]);
+        changed = changed || (now != reached[l]);
+        reached[l] = now;
+    }
+    return changed;
+}
+
+#endif
+
+}
+
+const char* BatchEvaluator::getInstructionSet() noexcept
+{
+    return InstructionSet;
+}
+
+BatchEvaluator::BatchEvaluator()
+{
+    clear();
+}
+
+void BatchEvaluator::clear() noexcept
+{
+    for (auto&& tile : m_tiles)
+    {
+        tile.fill(static_cast<uint8_t>(TileContent::Wall));
+    }
+    m_laneCount = 0U;
+}
+
+uint8_t BatchEvaluator::getLaneCount() const noexcept
+{
+    return m_laneCount;
+}
+
+uint8_t BatchEvaluator::tileIndex(uint8_t rowIdx, uint8_t colIdx) const noexcept
+{
+    return rowIdx * MapCols + colIdx;
+}
+
+uint8_t BatchEvaluator::addBoard(const GameMap& map)
+{
+    if (m_laneCount >= Lanes)
+    {
+        throw std::runtime_error("Board batch is full");
+    }
+    uint8_t lane = m_laneCount++;
+    for (uint8_t i = 1U; i < MapRows - 1; ++i)
+    {
+        for (uint8_t j = 1U; j < MapCols - 1; ++j)
+        {
+            m_tiles[tileIndex(i, j)][lane] = static_cast<uint8_t>(map.getTileContent(i, j));
+        }
+    }
+    return lane;
+}
+
+uint8_t BatchEvaluator::addBoard(const GamePool& pool, SessionHandle handle)
+{
+    if (m_laneCount >= Lanes)
+    {
+        throw std::runtime_error("Board batch is full");
+    }
+    uint8_t lane = m_laneCount++;
+    for (uint8_t i = 1U; i < MapRows - 1; ++i)
+    {
+        for (uint8_t j = 1U; j < MapCols - 1; ++j)
+        {
+            m_tiles[tileIndex(i, j)][lane] = static_cast<uint8_t>(pool.getTileContent(handle, i - 1, j - 1));
+        }
+    }
+    return lane;
+}
+
+TileContent BatchEvaluator::getTileContent(uint8_t lane, uint8_t rowIdx, uint8_t colIdx) const noexcept
+{
+    return static_cast<TileContent>(m_tiles[tileIndex(rowIdx, colIdx)][lane]);
+}
+
+void BatchEvaluator::countLines(uint8_t rowIdx, uint8_t colIdx, const uint8_t* contents, int vacatedTile, uint8_t* lengths) const noexcept
+{
+    static constexpr int8_t Directions[4][2] { {0, 1}, {1, 1}, {1, 0}, {1, -1} };
+
+    std::fill(lengths, lengths + Lanes, 0U);
+    alignas(32) uint8_t active[Lanes];
+    alignas(32) uint8_t count[Lanes];
+    for (auto&& direction : Directions)
+    {
+        std::fill(count, count + Lanes, 1U);
+        for (int sign = -1; sign <= 1; sign += 2)
+        {
+            std::fill(active, active + Lanes, 0xFF);
+            int r = rowIdx + sign * direction[0];
+            int c = colIdx + sign * direction[1];
+            // The sentinel walls never match a colour, so the walk stops at the border row/column
+            while (r > 0 && r < MapRows - 1 && c > 0 && c < MapCols - 1)
+            {
+                int idx = tileIndex(r, c);
+                if (idx == vacatedTile)
+                {
+                    break;
+                }
+                accumulateRun(m_tiles[idx].data(), contents, active, count);
+                r += sign * direction[0];
+                c += sign * direction[1];
+            }
+        }
+        maxInto(lengths, count);
+    }
+}
+
+void BatchEvaluator::checkForScore(uint8_t rowIdx, uint8_t colIdx, const LaneContents& contents, LaneBytes& lengths) const noexcept
+{
+    alignas(32) uint8_t values[Lanes];
+    for (uint8_t l = 0U; l < Lanes; ++l)
+    {
+        values[l] = static_cast<uint8_t>(contents[l]);
+    }
+    countLines(rowIdx, colIdx, values, -1, lengths.data());
+}
+
+void BatchEvaluator::floodFill(uint8_t fromRow, uint8_t fromCol, uint8_t* reached) const noexcept
+{
+    alignas(32) uint8_t freeTiles[MapTiles][Lanes];
+    alignas(32) uint8_t none[Lanes];
+    std::fill(none, none + Lanes, static_cast<uint8_t>(TileContent::None));
+    for (uint8_t i = 0U; i < MapTiles; ++i)
+    {
+        compareEqual(m_tiles[i].data(), none, freeTiles[i]);
+    }
+
+    std::fill(reached, reached + MapTiles * Lanes, 0U);
+    const uint8_t from = tileIndex(fromRow, fromCol);
+    const uint8_t neighbours[4] { static_cast<uint8_t>(from - MapCols), static_cast<uint8_t>(from - 1),
+                                  static_cast<uint8_t>(from + MapCols), static_cast<uint8_t>(from + 1) };
+    for (uint8_t n : neighbours)
+    {
+        std::copy_n(freeTiles[n], Lanes, reached + n * Lanes);
+    }
+
+    // Alternate forward and backward sweeps until no lane grows its region any more
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (uint8_t i = 1U; i < MapRows - 1; ++i)
+        {
+            for (uint8_t j = 1U; j < MapCols - 1; ++j)
+            {
+                uint8_t idx = tileIndex(i, j);
+                changed |= spread(reached + idx * Lanes, freeTiles[idx], reached + (idx - MapCols) * Lanes,
+                                  reached + (idx - 1) * Lanes, reached + (idx + MapCols) * Lanes, reached + (idx + 1) * Lanes);
+            }
+        }
+        for (uint8_t i = MapRows - 2; i > 0U; --i)
+        {
+            for (uint8_t j = MapCols - 2; j > 0U; --j)
+            {
+                uint8_t idx = tileIndex(i, j);
+                changed |= spread(reached + idx * Lanes, freeTiles[idx], reached + (idx - MapCols) * Lanes,
+                                  reached + (idx - 1) * Lanes, reached + (idx + MapCols) * Lanes, reached + (idx + 1) * Lanes);
+            }
+        }
+    }
+}
+
+void BatchEvaluator::findPath(uint8_t fromRow, uint8_t fromCol, uint8_t destRow, uint8_t destCol, LaneBytes& found) const noexcept
+{
+    alignas(32) uint8_t reached[MapTiles * Lanes];
+    floodFill(fromRow, fromCol, reached);
+    std::copy_n(reached + tileIndex(destRow, destCol) * Lanes, Lanes, found.begin());
+}
+
+void BatchEvaluator::evaluateMove(uint8_t fromRow, uint8_t fromCol, uint8_t destRow, uint8_t destCol, LaneBytes& lengths) const noexcept
+{
+    LaneBytes legal;
+    findPath(fromRow, fromCol, destRow, destCol, legal);
+
+    // The moved ball takes its colour from the source tile; an empty source makes the move illegal
+    const uint8_t from = tileIndex(fromRow, fromCol);
+    alignas(32) uint8_t occupied[Lanes];
+    alignas(32) uint8_t none[Lanes];
+    std::fill(none, none + Lanes, static_cast<uint8_t>(TileContent::None));
+    compareEqual(m_tiles[from].data(), none, occupied);
+    for (uint8_t l = 0U; l < Lanes; ++l)
+    {
+        occupied[l] = static_cast<uint8_t>(~occupied[l]);
+    }
+    andInto(legal.data(), occupied);
+
+    countLines(destRow, destCol, m_tiles[from].data(), from, lengths.data());
+    andInto(lengths.data(), legal.data());
+}
+
+}
@@ -0,0 +1,57 @@
+#ifndef BATCHEVALUATOR_H
+#define BATCHEVALUATOR_H
+
+#include <cstdint>
+#include <array>
+
+#include "gamemap.h"
+#include "gamepool.h"
+
+namespace Qoolkie
+{
+
+// Runs GameMap::checkForScore and GameMap::findPath for up to 32 boards at once.
+// Boards are kept lane-per-board: for every tile (walls included, same coordinates
+// as GameMap) one byte per board, so a single AVX2 register, two SSE2 registers or
+// a scalar loop covers the same tile on every board. Lanes beyond getLaneCount()
+// hold walls and their results are unspecified.
+class BatchEvaluator
+{
+public:
+    static constexpr uint8_t Lanes {32};
+    static constexpr uint8_t MapRows {GamePool::BoardRows + 2};
+    static constexpr uint8_t MapCols {GamePool::BoardCols + 2};
+    static constexpr uint8_t MapTiles {MapRows * MapCols};
+
+    using LaneBytes = std::array<uint8_t, Lanes>;
+    using LaneContents = std::array<TileContent, Lanes>;
+
+    static const char* getInstructionSet() noexcept;
+
+    BatchEvaluator();
+
+    void clear() noexcept;
+    uint8_t getLaneCount() const noexcept;
+    uint8_t addBoard(const GameMap& map);
+    uint8_t addBoard(const GamePool& pool, SessionHandle handle);
+    TileContent getTileContent(uint8_t lane, uint8_t rowIdx, uint8_t colIdx) const noexcept;
+
+    // Length of the longest line checkForScore would return for the given content at (rowIdx, colIdx)
+    void checkForScore(uint8_t rowIdx, uint8_t colIdx, const LaneContents& contents, LaneBytes& lengths) const noexcept;
+    // 0xFF for lanes where findPath(fromRow, fromCol, destRow, destCol) holds, 0 otherwise
+    void findPath(uint8_t fromRow, uint8_t fromCol, uint8_t destRow, uint8_t destCol, LaneBytes& found) const noexcept;
+    // Moves the ball at (fromRow, fromCol) in every lane; lengths are 0 where the move is illegal
+    void evaluateMove(uint8_t fromRow, uint8_t fromCol, uint8_t destRow, uint8_t destCol, LaneBytes& lengths) const noexcept;
+
+private:
+    uint8_t tileIndex(uint8_t rowIdx, uint8_t colIdx) const noexcept;
+    void floodFill(uint8_t fromRow, uint8_t fromCol, uint8_t* reached) const noexcept;
+    void countLines(uint8_t rowIdx, uint8_t colIdx, const uint8_t* contents, int vacatedTile, uint8_t* lengths) const noexcept;
+
+    alignas(32) std::array<std::array<uint8_t, Lanes>, MapTiles> m_tiles;
+    uint8_t m_laneCount {0U};
+};
+
+}
+
+#endif
@@ -0,0 +1,104 @@
+#include "deadposition.h"
+
+#include <algorithm>
+#include <array>
+
+namespace Qoolkie
+{
+
+namespace
+{
+
+using MapRules = GameMap::Rules;
+
+constexpr std::array<std::pair<int8_t, int8_t>, 4> LineDirections { std::make_pair(0, 1), std::make_pair(1, 1),
+                                                                     std::make_pair(1, 0), std::make_pair(1, -1) };
+
+// Fewest turns in which the window could hold a line of its most common colour. Each
+// ball of another colour has to be moved out, which takes the turn's move, and every
+// other tile of the window filled by a move or a spawn. Reachability and the colours
+// that actually spawn are ignored, so this never overestimates.
+uint8_t turnsToComplete(uint8_t freeCount, uint8_t othersCount)
+{
+    uint8_t fills = 2 * othersCount + freeCount;
+    uint8_t fillTurns = (fills + MapRules::SpawnsPerTurn) / (MapRules::SpawnsPerTurn + 1);
+    return std::max(othersCount, fillTurns);
+}
+
+}
+
+PositionVerdict classifyPosition(const GameMap& map)
+{
+    const uint8_t rows = map.getRowsCount();
+    const uint8_t cols = map.getColsCount();
+
+    uint8_t freeCount {0U};
+    bool isAnyMovable {false};
+    for (uint8_t i = 1U; i <= rows; ++i)
+    {
+        for (uint8_t j = 1U; j <= cols; ++j)
+        {
+            if (!map.isTileOccupied(i, j))
+            {
+                ++freeCount;
+            }
+            else if (!isAnyMovable)
+            {
+                // A ball next to a free tile can at least move there
+                isAnyMovable = !map.isTileOccupied(i - 1, j) || !map.isTileOccupied(i + 1, j) ||
+                               !map.isTileOccupied(i, j - 1) || !map.isTileOccupied(i, j + 1);
+            }
+        }
+    }
+    if (!isAnyMovable)
+    {
+        return PositionVerdict {PositionState::Stuck, 0U};
+    }
+
+    // Without a line every turn spawns its balls, so this many turns fill the board
+    uint8_t turnsLeft = (freeCount + MapRules::SpawnsPerTurn - 1) / MapRules::SpawnsPerTurn;
+    // No window on the board needs more than LineLength turns, only endgames are scanned
+    if (turnsLeft >= MapRules::LineLength)
+    {
+        return PositionVerdict {PositionState::Live, turnsLeft};
+    }
+
+    for (auto&& direction : LineDirections)
+    {
+        for (int i = 1; i <= rows; ++i)
+        {
+            for (int j = 1; j <= cols; ++j)
+            {
+                int lastRow = i + direction.first * (MapRules::LineLength - 1);
+                int lastCol = j + direction.second * (MapRules::LineLength - 1);
+                if (lastRow < 1 || lastRow > rows || lastCol < 1 || lastCol > cols)
+                {
+                    continue;
+                }
+                std::array<uint8_t, MapRules::ColoursCount> colourCounts {};
+                uint8_t windowFree {0U};
+                for (int k = 0; k < MapRules::LineLength; ++k)
+                {
+                    TileContent content = map.getTileContent(i + direction.first * k, j + direction.second * k);
+                    if (content == TileContent::None)
+                    {
+                        ++windowFree;
+                    }
+                    else
+                    {
+                        ++colourCounts[static_cast<uint8_t>(content)];
+                    }
+                }
+                uint8_t mostCommon = *std::max_element(colourCounts.begin(), colourCounts.end());
+                uint8_t othersCount = MapRules::LineLength - windowFree - mostCommon;
+                if (turnsToComplete(windowFree, othersCount) <= turnsLeft)
+                {
+                    return PositionVerdict {PositionState::Live, turnsLeft};
+                }
+            }
+        }
+    }
+    return PositionVerdict {PositionState::ForcedLoss, turnsLeft};
+}
+
+}
@@ -0,0 +1,34 @@
+#ifndef DEADPOSITION_H
+#define DEADPOSITION_H
+
+#include <cstdint>
+
+#include "gamemap.h"
+
+namespace Qoolkie
+{
+
+enum class PositionState : uint8_t
+{
+    Live,
+    // No line can be completed before the spawns fill the board, whatever is played
+    ForcedLoss,
+    // No ball can reach a free tile, so no move is left
+    Stuck
+};
+
+struct PositionVerdict
+{
+    PositionState state;
+    // For ForcedLoss, the turns until the board is full
+    uint8_t turnsLeft;
+};
+
+// Cheap enough to run after every turn. A ForcedLoss verdict is exact: every turn
+// left scores nothing, so the game's score is already final. The other direction is
+// not, a Live position may still turn out lost.
+PositionVerdict classifyPosition(const GameMap& map);
+
+}
+
+#endif
@@ -0,0 +1,737 @@
+#include "differentialfuzzer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+#include "game.h"
+#include "gamepool.h"
+
+namespace Qoolkie
+{
+
+constexpr uint8_t DifferentialFuzzer::MaxDivergences;
+constexpr uint8_t DifferentialFuzzer::BoardSize;
+
+namespace
+{
+
+constexpr const char* CheckNames[FuzzChecksCount] { "findPath", "shortestPath", "checkForScore", "evaluateMove",
+                                                    "legalMoves", "linePotential", "replay" };
+constexpr FuzzCheck BatchedChecks[] { FuzzCheck::FindPath, FuzzCheck::ShortestPath, FuzzCheck::CheckForScore,
+                                      FuzzCheck::EvaluateMove, FuzzCheck::LinePotential };
+// Every tile, one findPath each, makes the legal move reference slow; only a few boards a round get it
+constexpr uint8_t LegalMovesBoards {2U};
+constexpr char TileSymbols[] = "kbgpury#.";
+
+char getTileSymbol(TileContent content) noexcept
+{
+    return TileSymbols[static_cast<uint8_t>(content)];
+}
+
+bool isValidPath(const GameMap& board, const TilePath& path, const Move& probe)
+{
+    if (path.front() != std::pair<uint8_t, uint8_t>(probe.fromRow + 1, probe.fromCol + 1) ||
+        path.back() != std::pair<uint8_t, uint8_t>(probe.destRow + 1, probe.destCol + 1))
+    {
+        return false;
+    }
+    for (size_t i = 1U; i < path.size(); ++i)
+    {
+        int distance = std::abs(path[i].first - path[i - 1].first) + std::abs(path[i].second - path[i - 1].second);
+        if (distance != 1 || board.isTileOccupied(path[i].first, path[i].second))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t evaluateMove(const GameMap& board, const Move& probe)
+{
+    uint8_t x = probe.fromRow + 1;
+    uint8_t y = probe.fromCol + 1;
+    uint8_t destX = probe.destRow + 1;
+    uint8_t destY = probe.destCol + 1;
+    if (!board.isTileOccupied(x, y) || board.isTileOccupied(destX, destY) || !board.findPath(x, y, destX, destY))
+    {
+        return 0U;
+    }
+    GameMap moved {board};
+    TileContent content = moved.getTileContent(x, y);
+    moved.setTileContent(x, y, TileContent::None);
+    moved.setTileContent(destX, destY, content);
+    return moved.checkForScore(destX, destY, content).size();
+}
+
+uint64_t scanLinePotential(const GameMap& board, TileContent colour)
+{
+    using Rules = GameMap::Rules;
+    constexpr int Directions[4][2] { {0, 1}, {1, 1}, {1, 0}, {1, -1} };
+    uint64_t potential {0U};
+    if (static_cast<uint8_t>(colour) >= Rules::ColoursCount)
+    {
+        return potential;
+    }
+    for (auto&& direction : Directions)
+    {
+        for (int i = 1; i <= board.getRowsCount(); ++i)
+        {
+            for (int j = 1; j <= board.getColsCount(); ++j)
+            {
+                int lastRow = i + direction[0] * (Rules::LineLength - 1);
+                int lastCol = j + direction[1] * (Rules::LineLength - 1);
+                if (lastRow > board.getRowsCount() || lastCol < 1 || lastCol > board.getColsCount())
+                {
+                    continue;
+                }
+                uint8_t balls {0U};
+                bool isOpen {true};
+                for (int k = 0; k < Rules::LineLength; ++k)
+                {
+                    TileContent content = board.getTileContent(i + direction[0] * k, j + direction[1] * k);
+                    balls += content == colour ? 1U : 0U;
+                    isOpen = isOpen && (content == colour || content == TileContent::None);
+                }
+                potential += isOpen ? GameMap::LinePotentialWeights[balls] : 0U;
+            }
+        }
+    }
+    return potential;
+}
+
+// Move count in the high half, a hash of the sorted moves in the low one
+uint64_t hashMoves(std::vector<Move>& moves)
+{
+    auto key = [](const Move& move)
+    {
+        return (move.fromRow << 24) | (move.fromCol << 16) | (move.destRow << 8) | move.destCol;
+    };
+    std::sort(moves.begin(), moves.end(), [&key](const Move& a, const Move& b) { return key(a) < key(b); });
+    uint32_t hash {0x811C9DC5U};
+    for (auto&& move : moves)
+    {
+        hash = (hash ^ static_cast<uint32_t>(key(move))) * 0x01000193U;
+    }
+    return (static_cast<uint64_t>(moves.size()) << 32) | hash;
+}
+
+std::string describeResult(FuzzCheck check, uint64_t value)
+{
+    switch (check)
+    {
+    case FuzzCheck::FindPath:
+        return value != 0U ? "path" : "no path";
+    case FuzzCheck::ShortestPath:
+        return value == 0U ? "no path" : (value == 1U ? "path" : "invalid path");
+    case FuzzCheck::CheckForScore:
+        return "line of " + std::to_string(value);
+    case FuzzCheck::EvaluateMove:
+        return value != 0U ? "legal, line of " + std::to_string(value) : "illegal";
+    case FuzzCheck::LegalMoves:
+        return std::to_string(value >> 32) + " moves, hash " + std::to_string(value & 0xFFFFFFFFU);
+    case FuzzCheck::LinePotential:
+        return "potential " + std::to_string(value);
+    case FuzzCheck::Replay:
+        break;
+    }
+    return std::to_string(value);
+}
+
+std::string describeState(size_t moveIdx, bool isLegal, uint32_t score, bool isGameOver, int tileIdx, TileContent content)
+{
+    std::string state = "after move " + std::to_string(moveIdx) + ": " + (isLegal ? "legal" : "illegal") +
+                        ", score " + std::to_string(score) + (isGameOver ? ", game over" : "");
+    if (tileIdx >= 0)
+    {
+        state += ", tile " + std::to_string(tileIdx / GameMap::Rules::BoardSize) + ',' +
+                 std::to_string(tileIdx % GameMap::Rules::BoardSize) + " '" + getTileSymbol(content) + '\'';
+    }
+    return state;
+}
+
+}
+
+const char* DifferentialFuzzer::getCheckName(FuzzCheck check) noexcept
+{
+    return CheckNames[static_cast<uint8_t>(check)];
+}
+
+DifferentialFuzzer::DifferentialFuzzer(uint64_t seed) : m_rng(seed)
+{
+}
+
+TileContent DifferentialFuzzer::generateColour()
+{
+    // An empty probe colour is outside the game's use, both engines still have to agree on it
+    if (m_rng.nextBelow(16U) == 0U)
+    {
+        return TileContent::None;
+    }
+    return static_cast<TileContent>(m_rng.nextBelow(static_cast<uint32_t>(ColoursUsed::Seven)));
+}
+
+Move DifferentialFuzzer::generateProbe()
+{
+    // Half of the probes sit on the border rows and columns, next to the sentinel walls
+    auto generateTile = [this](uint8_t& row, uint8_t& col)
+    {
+        row = static_cast<uint8_t>(m_rng.nextBelow(BoardSize));
+        col = static_cast<uint8_t>(m_rng.nextBelow(BoardSize));
+        switch (m_rng.nextBelow(4U))
+        {
+        case 0:
+            row = m_rng.nextBelow(2U) == 0U ? 0U : BoardSize - 1U;
+            break;
+        case 1:
+            col = m_rng.nextBelow(2U) == 0U ? 0U : BoardSize - 1U;
+            break;
+        default:
+            break;
+        }
+    };
+    Move probe;
+    generateTile(probe.fromRow, probe.fromCol);
+    do
+    {
+        generateTile(probe.destRow, probe.destCol);
+    }
+    while (probe.destRow == probe.fromRow && probe.destCol == probe.fromCol);
+    return probe;
+}
+
+void DifferentialFuzzer::generateBoard(GameMap& board, const Move& probe)
+{
+    board.clearAllTiles();
+    auto fillRandom = [this, &board](uint32_t density)
+    {
+        for (uint8_t i = 1U; i <= BoardSize; ++i)
+        {
+            for (uint8_t j = 1U; j <= BoardSize; ++j)
+            {
+                if (m_rng.nextBelow(100U) < density)
+                {
+                    board.setTileContent(i, j, static_cast<TileContent>(m_rng.nextBelow(static_cast<uint32_t>(ColoursUsed::Seven))));
+                }
+            }
+        }
+    };
+
+    switch (m_rng.nextBelow(5U))
+    {
+    case 0:
+        fillRandom(m_rng.nextBelow(101U));
+        break;
+    case 1:
+    {
+        // Runs of one colour through a probe tile, often long enough to reach the walls
+        static constexpr int8_t Directions[4][2] { {0, 1}, {1, 1}, {1, 0}, {1, -1} };
+        fillRandom(m_rng.nextBelow(30U));
+        uint32_t runsCount = 1U + m_rng.nextBelow(3U);
+        for (uint32_t run = 0U; run < runsCount; ++run)
+        {
+            const int8_t* direction = Directions[m_rng.nextBelow(4U)];
+            bool isThroughDest = m_rng.nextBelow(2U) == 0U;
+            int row = (isThroughDest ? probe.destRow : probe.fromRow) + 1;
+            int col = (isThroughDest ? probe.destCol : probe.fromCol) + 1;
+            int back = static_cast<int>(m_rng.nextBelow(BoardSize));
+            while (back-- > 0 && row - direction[0] >= 1 && row - direction[0] <= BoardSize &&
+                   col - direction[1] >= 1 && col - direction[1] <= BoardSize)
+            {
+                row -= direction[0];
+                col -= direction[1];
+            }
+            TileContent colour = static_cast<TileContent>(m_rng.nextBelow(static_cast<uint32_t>(ColoursUsed::Seven)));
+            uint32_t length = 3U + m_rng.nextBelow(BoardSize - 2U);
+            for (uint32_t i = 0U; i < length && row >= 1 && row <= BoardSize && col >= 1 && col <= BoardSize; ++i)
+            {
+                board.setTileContent(row, col, colour);
+                row += direction[0];
+                col += direction[1];
+            }
+            if (m_rng.nextBelow(2U) == 0U)
+            {
+                board.setTileContent(probe.fromRow + 1, probe.fromCol + 1, colour);
+            }
+        }
+        board.setTileContent(probe.destRow + 1, probe.destCol + 1, TileContent::None);
+        break;
+    }
+    case 2:
+    {
+        // Full rows or columns of balls with at most one gap each
+        fillRandom(m_rng.nextBelow(20U));
+        uint32_t barriersCount = 1U + m_rng.nextBelow(4U);
+        for (uint32_t barrier = 0U; barrier < barriersCount; ++barrier)
+        {
+            bool isRow = m_rng.nextBelow(2U) == 0U;
+            uint8_t line = static_cast<uint8_t>(1U + m_rng.nextBelow(BoardSize));
+            uint32_t gap = m_rng.nextBelow(BoardSize + 1U);
+            for (uint8_t k = 1U; k <= BoardSize; ++k)
+            {
+                TileContent content = k == gap ? TileContent::None : TileContent::Black;
+                board.setTileContent(isRow ? line : k, isRow ? k : line, content);
+            }
+        }
+        break;
+    }
+    case 3:
+    {
+        // Nearly full, moves only fit through a hole or two
+        fillRandom(100U);
+        uint32_t holesCount = m_rng.nextBelow(4U);
+        for (uint32_t hole = 0U; hole < holesCount; ++hole)
+        {
+            board.setTileContent(1U + m_rng.nextBelow(BoardSize), 1U + m_rng.nextBelow(BoardSize), TileContent::None);
+        }
+        if (m_rng.nextBelow(2U) == 0U)
+        {
+            board.setTileContent(probe.destRow + 1, probe.destCol + 1, TileContent::None);
+        }
+        break;
+    }
+    default:
+        fillRandom(m_rng.nextBelow(4U));
+        break;
+    }
+
+    // The game only ever moves a ball, but an empty origin must be answered the same way too
+    if (m_rng.nextBelow(8U) != 0U && !board.isTileOccupied(probe.fromRow + 1, probe.fromCol + 1))
+    {
+        board.setTileContent(probe.fromRow + 1, probe.fromCol + 1, generateColour());
+    }
+}
+
+void DifferentialFuzzer::runBoardCheck(FuzzCheck check, std::vector<GameMap>& boards, const Move& probe,
+                                       const BatchEvaluator::LaneContents& contents, std::vector<uint64_t>& reference,
+                                       std::vector<uint64_t>& candidate, EngineTiming& timing)
+{
+    uint8_t x = probe.fromRow + 1;
+    uint8_t y = probe.fromCol + 1;
+    uint8_t destX = probe.destRow + 1;
+    uint8_t destY = probe.destCol + 1;
+    reference.assign(boards.size(), 0U);
+    candidate.assign(boards.size(), 0U);
+
+    QElapsedTimer timer;
+    timer.start();
+    for (size_t l = 0U; l < boards.size(); ++l)
+    {
+        const GameMap& board = boards[l];
+        switch (check)
+        {
+        case FuzzCheck::FindPath:
+        case FuzzCheck::ShortestPath:
+            reference[l] = board.findPath(x, y, destX, destY) ? 1U : 0U;
+            break;
+        case FuzzCheck::CheckForScore:
+            reference[l] = board.checkForScore(x, y, contents[l]).size();
+            break;
+        case FuzzCheck::EvaluateMove:
+            reference[l] = evaluateMove(board, probe);
+            break;
+        case FuzzCheck::LegalMoves:
+        {
+            m_moves.clear();
+            for (uint8_t i = 1U; i <= BoardSize; ++i)
+            {
+                for (uint8_t j = 1U; j <= BoardSize; ++j)
+                {
+                    if (!board.isTileOccupied(i, j))
+                    {
+                        continue;
+                    }
+                    for (uint8_t k = 1U; k <= BoardSize; ++k)
+                    {
+                        for (uint8_t m = 1U; m <= BoardSize; ++m)
+                        {
+                            if (!board.isTileOccupied(k, m) && board.findPath(i, j, k, m))
+                            {
+                                m_moves.push_back(Move {static_cast<uint8_t>(i - 1), static_cast<uint8_t>(j - 1),
+                                                        static_cast<uint8_t>(k - 1), static_cast<uint8_t>(m - 1)});
+                            }
+                        }
+                    }
+                }
+            }
+            reference[l] = hashMoves(m_moves);
+            break;
+        }
+        case FuzzCheck::LinePotential:
+            reference[l] = scanLinePotential(board, contents[l]);
+            break;
+        case FuzzCheck::Replay:
+            break;
+        }
+    }
+    timing.referenceNs += timer.nsecsElapsed();
+
+    timer.start();
+    if (check == FuzzCheck::ShortestPath || check == FuzzCheck::LegalMoves || check == FuzzCheck::LinePotential)
+    {
+        for (size_t l = 0U; l < boards.size(); ++l)
+        {
+            if (check == FuzzCheck::ShortestPath)
+            {
+                TilePath path = boards[l].findShortestPath(x, y, destX, destY);
+                candidate[l] = path.empty() ? 0U : (isValidPath(boards[l], path, probe) ? 1U : 2U);
+            }
+            else if (check == FuzzCheck::LinePotential)
+            {
+                boards[l].updateLinePotential();
+                candidate[l] = boards[l].getLinePotential(contents[l]);
+            }
+            else
+            {
+                collectLegalMoves(boards[l], m_moves);
+                candidate[l] = hashMoves(m_moves);
+            }
+        }
+    }
+    else
+    {
+        BatchEvaluator::LaneBytes results;
+        for (size_t first = 0U; first < boards.size(); first += BatchEvaluator::Lanes)
+        {
+            m_evaluator.clear();
+            size_t last = std::min(boards.size(), first + BatchEvaluator::Lanes);
+            for (size_t l = first; l < last; ++l)
+            {
+                m_evaluator.addBoard(boards[l]);
+            }
+            if (check == FuzzCheck::FindPath)
+            {
+                m_evaluator.findPath(x, y, destX, destY, results);
+            }
+            else if (check == FuzzCheck::CheckForScore)
+            {
+                BatchEvaluator::LaneContents laneContents;
+                std::copy(contents.begin() + first, contents.begin() + last, laneContents.begin());
+                m_evaluator.checkForScore(x, y, laneContents, results);
+            }
+            else
+            {
+                m_evaluator.evaluateMove(x, y, destX, destY, results);
+            }
+            for (size_t l = first; l < last; ++l)
+            {
+                uint8_t result = results[l - first];
+                candidate[l] = check == FuzzCheck::FindPath ? (result != 0U ? 1U : 0U) : result;
+            }
+        }
+    }
+    timing.candidateNs += timer.nsecsElapsed();
+    timing.queries += boards.size();
+}
+
+bool DifferentialFuzzer::runReplay(const FuzzCase& fuzzCase, std::string& reference, std::string& candidate,
+                                   EngineTiming& timing, size_t& divergedAt)
+{
+    Game game;
+    game.start(fuzzCase.colours, fuzzCase.seed);
+    GamePool pool {1U};
+    SessionHandle handle = pool.acquire(fuzzCase.colours, fuzzCase.seed);
+
+    QElapsedTimer timer;
+    for (size_t i = 0U; i <= fuzzCase.moves.size(); ++i)
+    {
+        // Index 0 compares the starting boards
+        bool isLegal {true};
+        bool isPoolLegal {true};
+        if (i > 0U)
+        {
+            const Move& move = fuzzCase.moves[i - 1];
+            timer.start();
+            isLegal = game.moveBall(move.fromRow, move.fromCol, move.destRow, move.destCol);
+            timing.referenceNs += timer.nsecsElapsed();
+            timer.start();
+            isPoolLegal = pool.move(handle, move.fromRow, move.fromCol, move.destRow, move.destCol).isLegal;
+            timing.candidateNs += timer.nsecsElapsed();
+            ++timing.queries;
+        }
+
+        int tileIdx {-1};
+        for (uint8_t row = 0U; row < BoardSize && tileIdx < 0; ++row)
+        {
+            for (uint8_t col = 0U; col < BoardSize; ++col)
+            {
+                if (game.getMap().getTileContent(row + 1, col + 1) != pool.getTileContent(handle, row, col))
+                {
+                    tileIdx = row * BoardSize + col;
+                    break;
+                }
+            }
+        }
+        if (tileIdx >= 0 || isLegal != isPoolLegal || game.getScore() != pool.getScore(handle) ||
+            game.isGameOver() != pool.isGameOver(handle))
+        {
+            uint8_t row = tileIdx >= 0 ? tileIdx / BoardSize : 0U;
+            uint8_t col = tileIdx >= 0 ? tileIdx % BoardSize : 0U;
+            reference = describeState(i, isLegal, game.getScore(), game.isGameOver(), tileIdx,
+                                      game.getMap().getTileContent(row + 1, col + 1));
+            candidate = describeState(i, isPoolLegal, pool.getScore(handle), pool.isGameOver(handle), tileIdx,
+                                      pool.getTileContent(handle, row, col));
+            divergedAt = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DifferentialFuzzer::compare(const FuzzCase& fuzzCase, std::string& reference, std::string& candidate)
+{
+    EngineTiming timing;
+    if (fuzzCase.check == FuzzCheck::Replay)
+    {
+        size_t divergedAt {0U};
+        return runReplay(fuzzCase, reference, candidate, timing, divergedAt);
+    }
+
+    std::vector<GameMap> boards {fuzzCase.board};
+    BatchEvaluator::LaneContents contents;
+    contents.fill(TileContent::None);
+    contents[0] = fuzzCase.content;
+    std::vector<uint64_t> referenceResults;
+    std::vector<uint64_t> candidateResults;
+    runBoardCheck(fuzzCase.check, boards, fuzzCase.probe, contents, referenceResults, candidateResults, timing);
+    reference = describeResult(fuzzCase.check, referenceResults[0]);
+    candidate = describeResult(fuzzCase.check, candidateResults[0]);
+    return referenceResults[0] != candidateResults[0];
+}
+
+FuzzCase DifferentialFuzzer::minimize(const FuzzCase& fuzzCase)
+{
+    FuzzCase smallest {fuzzCase};
+    std::string reference;
+    std::string candidate;
+    EngineTiming timing;
+
+    if (fuzzCase.check == FuzzCheck::Replay)
+    {
+        // Drop halves, then quarters and so on of the moves while the engines still disagree
+        size_t divergedAt {0U};
+        if (!runReplay(smallest, reference, candidate, timing, divergedAt))
+        {
+            return smallest;
+        }
+        smallest.moves.resize(divergedAt);
+        for (size_t chunk = std::max<size_t>(smallest.moves.size() / 2U, 1U); chunk > 0U && !smallest.moves.empty(); chunk /= 2U)
+        {
+            size_t start {0U};
+            while (start < smallest.moves.size())
+            {
+                FuzzCase trial {smallest};
+                size_t end = std::min(start + chunk, trial.moves.size());
+                trial.moves.erase(trial.moves.begin() + start, trial.moves.begin() + end);
+                if (runReplay(trial, reference, candidate, timing, divergedAt))
+                {
+                    trial.moves.resize(divergedAt);
+                    smallest = trial;
+                }
+                else
+                {
+                    start += chunk;
+                }
+            }
+        }
+        return smallest;
+    }
+
+    // Remove balls one at a time until every remaining one is needed for the divergence
+    bool isShrunk {true};
+    while (isShrunk)
+    {
+        isShrunk = false;
+        for (uint8_t i = 1U; i <= BoardSize; ++i)
+        {
+            for (uint8_t j = 1U; j <= BoardSize; ++j)
+            {
+                if (!smallest.board.isTileOccupied(i, j))
+                {
+                    continue;
+                }
+                FuzzCase trial {smallest};
+                trial.board.setTileContent(i, j, TileContent::None);
+                if (compare(trial, reference, candidate))
+                {
+                    smallest = trial;
+                    isShrunk = true;
+                }
+            }
+        }
+    }
+    return smallest;
+}
+
+void DifferentialFuzzer::recordDivergence(FuzzReport& report, const FuzzCase& fuzzCase)
+{
+    if (report.divergences.size() >= MaxDivergences)
+    {
+        return;
+    }
+    Divergence divergence;
+    divergence.reproducer = minimize(fuzzCase);
+    compare(divergence.reproducer, divergence.reference, divergence.candidate);
+    report.divergences.push_back(divergence);
+}
+
+FuzzReport DifferentialFuzzer::run(uint32_t rounds, uint32_t replayMoves)
+{
+    FuzzReport report;
+    std::vector<GameMap> boards(BatchEvaluator::Lanes);
+    std::vector<GameMap> legalMovesBoards(LegalMovesBoards);
+    BatchEvaluator::LaneContents contents;
+    std::vector<uint64_t> reference;
+    std::vector<uint64_t> candidate;
+    Game game;
+
+    for (uint32_t round = 0U; round < rounds; ++round)
+    {
+        Move probe = generateProbe();
+        for (size_t l = 0U; l < boards.size(); ++l)
+        {
+            generateBoard(boards[l], probe);
+            contents[l] = generateColour();
+        }
+
+        for (FuzzCheck check : BatchedChecks)
+        {
+            runBoardCheck(check, boards, probe, contents, reference, candidate, report.timings[static_cast<uint8_t>(check)]);
+            for (size_t l = 0U; l < boards.size(); ++l)
+            {
+                if (reference[l] != candidate[l])
+                {
+                    FuzzCase fuzzCase;
+                    fuzzCase.check = check;
+                    fuzzCase.board = boards[l];
+                    fuzzCase.probe = probe;
+                    fuzzCase.content = contents[l];
+                    recordDivergence(report, fuzzCase);
+                }
+            }
+        }
+
+        std::copy(boards.begin(), boards.begin() + LegalMovesBoards, legalMovesBoards.begin());
+        runBoardCheck(FuzzCheck::LegalMoves, legalMovesBoards, probe, contents, reference, candidate,
+                      report.timings[static_cast<uint8_t>(FuzzCheck::LegalMoves)]);
+        for (size_t l = 0U; l < legalMovesBoards.size(); ++l)
+        {
+            if (reference[l] != candidate[l])
+            {
+                FuzzCase fuzzCase;
+                fuzzCase.check = FuzzCheck::LegalMoves;
+                fuzzCase.board = legalMovesBoards[l];
+                recordDivergence(report, fuzzCase);
+            }
+        }
+
+        // Mostly legal moves so games get long, mixed with moves from empty tiles, onto
+        // balls and off the board
+        FuzzCase replay;
+        replay.check = FuzzCheck::Replay;
+        replay.seed = m_rng.next();
+        replay.colours = m_rng.nextBelow(2U) == 0U ? ColoursUsed::Five : ColoursUsed::Seven;
+        game.start(replay.colours, replay.seed);
+        for (uint32_t i = 0U; i < replayMoves && !game.isGameOver(); ++i)
+        {
+            collectLegalMoves(game.getMap(), m_moves);
+            Move move;
+            if (!m_moves.empty() && m_rng.nextBelow(4U) != 0U)
+            {
+                move = m_moves[m_rng.nextBelow(static_cast<uint32_t>(m_moves.size()))];
+            }
+            else
+            {
+                move = Move {static_cast<uint8_t>(m_rng.nextBelow(BoardSize + 1U)), static_cast<uint8_t>(m_rng.nextBelow(BoardSize + 1U)),
+                             static_cast<uint8_t>(m_rng.nextBelow(BoardSize + 1U)), static_cast<uint8_t>(m_rng.nextBelow(BoardSize + 1U))};
+            }
+            replay.moves.push_back(move);
+            game.moveBall(move.fromRow, move.fromCol, move.destRow, move.destCol);
+        }
+        std::string referenceState;
+        std::string candidateState;
+        size_t divergedAt {0U};
+        if (runReplay(replay, referenceState, candidateState, report.timings[static_cast<uint8_t>(FuzzCheck::Replay)], divergedAt))
+        {
+            recordDivergence(report, replay);
+        }
+        ++report.rounds;
+    }
+    return report;
+}
+
+std::string formatFuzzCase(const FuzzCase& fuzzCase)
+{
+    std::string text = std::string(DifferentialFuzzer::getCheckName(fuzzCase.check)) + '\n';
+    if (fuzzCase.check == FuzzCheck::Replay)
+    {
+        text += "seed " + std::to_string(fuzzCase.seed) + ", " +
+                (fuzzCase.colours == ColoursUsed::Five ? "5" : "7") + " colours, moves:\n";
+        for (auto&& move : fuzzCase.moves)
+        {
+            text += std::to_string(move.fromRow) + ',' + std::to_string(move.fromCol) + " -> " +
+                    std::to_string(move.destRow) + ',' + std::to_string(move.destCol) + '\n';
+        }
+        return text;
+    }
+
+    if (fuzzCase.check == FuzzCheck::LinePotential)
+    {
+        text += std::string("colour '") + getTileSymbol(fuzzCase.content) + "'\n";
+    }
+    else if (fuzzCase.check != FuzzCheck::LegalMoves)
+    {
+        text += "probe " + std::to_string(fuzzCase.probe.fromRow) + ',' + std::to_string(fuzzCase.probe.fromCol);
+        if (fuzzCase.check == FuzzCheck::CheckForScore)
+        {
+            text += std::string(" colour '") + getTileSymbol(fuzzCase.content) + "'\n";
+        }
+        else
+        {
+            text += " -> " + std::to_string(fuzzCase.probe.destRow) + ',' + std::to_string(fuzzCase.probe.destCol) + '\n';
+        }
+    }
+    // Same layout as a --solve puzzle file
+    for (uint8_t i = 1U; i <= fuzzCase.board.getRowsCount(); ++i)
+    {
+        for (uint8_t j = 1U; j <= fuzzCase.board.getColsCount(); ++j)
+        {
+            text += getTileSymbol(fuzzCase.board.getTileContent(i, j));
+        }
+        text += '\n';
+    }
+    return text;
+}
+
+int runFuzzer(uint32_t rounds, uint64_t seed, uint32_t replayMoves)
+{
+    QTextStream out(stdout);
+    out << "Fuzzing " << rounds << " rounds from seed " << seed << ", BatchEvaluator uses " << BatchEvaluator::getInstructionSet() << endl;
+
+    DifferentialFuzzer fuzzer {seed};
+    FuzzReport report = fuzzer.run(rounds, replayMoves);
+
+    out << "check\tqueries\treference/s\tcandidate/s\tspeed-up" << endl;
+    for (uint8_t i = 0U; i < FuzzChecksCount; ++i)
+    {
+        const EngineTiming& timing = report.timings[i];
+        double referenceRate = timing.referenceNs > 0 ? timing.queries * 1e9 / timing.referenceNs : 0.0;
+        double candidateRate = timing.candidateNs > 0 ? timing.queries * 1e9 / timing.candidateNs : 0.0;
+        out << DifferentialFuzzer::getCheckName(static_cast<FuzzCheck>(i)) << '\t' << timing.queries << '\t'
+            << qRound64(referenceRate) << '\t' << qRound64(candidateRate) << '\t'
+            << (referenceRate > 0.0 ? candidateRate / referenceRate : 0.0) << endl;
+    }
+
+    for (auto&& divergence : report.divergences)
+    {
+        out << endl << QString::fromStdString(formatFuzzCase(divergence.reproducer))
+            << "reference: " << QString::fromStdString(divergence.reference) << endl
+            << "candidate: " << QString::fromStdString(divergence.candidate) << endl;
+    }
+    out << report.divergences.size() << (report.divergences.size() >= DifferentialFuzzer::MaxDivergences ? "+" : "")
+        << " divergences" << endl;
+    return report.divergences.empty() ? 0 : 1;
+}
+
+}
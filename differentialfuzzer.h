@@ -0,0 +1,109 @@
+#ifndef DIFFERENTIALFUZZER_H
+#define DIFFERENTIALFUZZER_H
+
+#include <cstdint>
+#include <array>
+#include <string>
+#include <vector>
+
+#include "batchevaluator.h"
+#include "gamemap.h"
+#include "player.h"
+#include "rng.h"
+
+namespace Qoolkie
+{
+
+// Every check runs GameMap or Game, the reference rules, against a faster engine
+// that must agree with them on every input
+enum class FuzzCheck : uint8_t
+{
+    FindPath,       // GameMap::findPath against BatchEvaluator::findPath
+    ShortestPath,   // GameMap::findPath against GameMap::findShortestPath
+    CheckForScore,  // GameMap::checkForScore against BatchEvaluator::checkForScore
+    EvaluateMove,   // A move made on a GameMap against BatchEvaluator::evaluateMove
+    LegalMoves,     // GameMap::findPath for every move against collectLegalMoves
+    LinePotential,  // Scanning every line window against GameMap::getLinePotential
+    Replay          // Game against GamePool over a whole move sequence
+};
+
+constexpr uint8_t FuzzChecksCount {7};
+
+// One input: a board and a probe for the board checks, a seed and moves for a
+// replay. Coordinates are 0-based, as in Game::moveBall.
+struct FuzzCase
+{
+    FuzzCheck check {FuzzCheck::FindPath};
+    GameMap board;
+    Move probe {0U, 0U, 0U, 0U};
+    TileContent content {TileContent::None};
+    uint64_t seed {0U};
+    ColoursUsed colours {ColoursUsed::Five};
+    std::vector<Move> moves;
+};
+
+struct Divergence
+{
+    FuzzCase reproducer;
+    std::string reference;
+    std::string candidate;
+};
+
+struct EngineTiming
+{
+    uint64_t queries {0U};
+    int64_t referenceNs {0};
+    int64_t candidateNs {0};
+};
+
+struct FuzzReport
+{
+    uint64_t rounds {0U};
+    std::array<EngineTiming, FuzzChecksCount> timings;
+    std::vector<Divergence> divergences;
+};
+
+// Generates boards and move sequences, random as well as adversarial ones (lines
+// running into the walls and corners, mazes with single gaps, nearly full boards),
+// and runs them through the reference and the candidate engines side by side.
+// Board checks go through BatchEvaluator a full batch at a time, so the timings
+// reflect how the engines are actually used. A divergence is shrunk to a small
+// reproducer by removing balls, or moves, for as long as the engines still disagree.
+class DifferentialFuzzer
+{
+public:
+    static constexpr uint8_t MaxDivergences {16};
+
+    static const char* getCheckName(FuzzCheck check) noexcept;
+
+    explicit DifferentialFuzzer(uint64_t seed);
+
+    FuzzReport run(uint32_t rounds, uint32_t replayMoves);
+    // Whether the engines disagree on the case, with what each of them answered
+    bool compare(const FuzzCase& fuzzCase, std::string& reference, std::string& candidate);
+    FuzzCase minimize(const FuzzCase& fuzzCase);
+
+private:
+    static constexpr uint8_t BoardSize {GameMap::Rules::BoardSize};
+
+    void generateBoard(GameMap& board, const Move& probe);
+    Move generateProbe();
+    TileContent generateColour();
+    void runBoardCheck(FuzzCheck check, std::vector<GameMap>& boards, const Move& probe,
+                       const BatchEvaluator::LaneContents& contents, std::vector<uint64_t>& reference,
+                       std::vector<uint64_t>& candidate, EngineTiming& timing);
+    bool runReplay(const FuzzCase& fuzzCase, std::string& reference, std::string& candidate, EngineTiming& timing,
+                   size_t& divergedAt);
+    void recordDivergence(FuzzReport& report, const FuzzCase& fuzzCase);
+
+    Rng m_rng;
+    BatchEvaluator m_evaluator;
+    std::vector<Move> m_moves;
+};
+
+std::string formatFuzzCase(const FuzzCase& fuzzCase);
+int runFuzzer(uint32_t rounds, uint64_t seed, uint32_t replayMoves);
+
+}
+
+#endif
@@ -0,0 +1,266 @@
+#include "featureextractor.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Qoolkie
+{
+
+constexpr uint8_t FeatureExtractor::Lanes;
+constexpr uint8_t FeatureExtractor::BoardSize;
+constexpr uint8_t FeatureExtractor::Cells;
+constexpr uint8_t FeatureExtractor::ColoursCount;
+constexpr uint8_t FeatureExtractor::DirectionsCount;
+constexpr uint16_t FeatureExtractor::OccupancyFeature;
+constexpr uint16_t FeatureExtractor::RegionFeature;
+constexpr uint16_t FeatureExtractor::SpanFeature;
+constexpr uint16_t FeatureExtractor::FreeCountFeature;
+constexpr uint16_t FeatureExtractor::FeaturesCount;
+constexpr uint8_t FeatureExtractor::MapCols;
+constexpr uint8_t FeatureExtractor::MapTiles;
+constexpr uint8_t FeatureExtractor::NoRegion;
+
+namespace
+{
+
+constexpr uint8_t NoneValue {static_cast<uint8_t>(TileContent::None)};
+
+}
+
+FeatureExtractor::FeatureExtractor() : m_features(FeaturesCount)
+{
+    clear();
+}
+
+void FeatureExtractor::clear() noexcept
+{
+    for (auto&& tile : m_tiles)
+    {
+        tile.fill(static_cast<uint8_t>(TileContent::Wall));
+    }
+    m_laneCount = 0U;
+}
+
+uint8_t FeatureExtractor::getLaneCount() const noexcept
+{
+    return m_laneCount;
+}
+
+uint8_t FeatureExtractor::tileIndex(uint8_t rowIdx, uint8_t colIdx) const noexcept
+{
+    return rowIdx * MapCols + colIdx;
+}
+
+uint8_t FeatureExtractor::addBoard(const GameMap& map)
+{
+    if (m_laneCount >= Lanes)
+    {
+        throw std::runtime_error("Board batch is full");
+    }
+    if (map.getRowsCount() != BoardSize || map.getColsCount() != BoardSize)
+    {
+        throw std::runtime_error("Features are only extracted from 9x9 boards");
+    }
+    uint8_t lane = m_laneCount++;
+    for (uint8_t i = 1U; i <= BoardSize; ++i)
+    {
+        for (uint8_t j = 1U; j <= BoardSize; ++j)
+        {
+            m_tiles[tileIndex(i, j)][lane] = static_cast<uint8_t>(map.getTileContent(i, j));
+        }
+    }
+    return lane;
+}
+
+const FeatureExtractor::LaneBytes& FeatureExtractor::getFeature(uint16_t feature) const noexcept
+{
+    return m_features[feature];
+}
+
+void FeatureExtractor::copyFeatures(uint8_t lane, uint8_t* features) const noexcept
+{
+    for (uint16_t i = 0U; i < FeaturesCount; ++i)
+    {
+        features[i] = m_features[i][lane];
+    }
+}
+
+void FeatureExtractor::extract() noexcept
+{
+    extractOccupancy();
+    extractRegions();
+    extractSpans();
+}
+
+void FeatureExtractor::extractOccupancy() noexcept
+{
+    LaneBytes& freeCount = m_features[FreeCountFeature];
+    freeCount.fill(0U);
+    for (uint8_t i = 1U; i <= BoardSize; ++i)
+    {
+        for (uint8_t j = 1U; j <= BoardSize; ++j)
+        {
+            const LaneBytes& tile = m_tiles[tileIndex(i, j)];
+            uint8_t cell = (i - 1) * BoardSize + (j - 1);
+            for (uint8_t colour = 0U; colour < ColoursCount; ++colour)
+            {
+                LaneBytes& plane = m_features[OccupancyFeature + colour * Cells + cell];
+                for (uint8_t l = 0U; l < Lanes; ++l)
+                {
+                    plane[l] = tile[l] == colour ? 1U : 0U;
+                }
+            }
+            for (uint8_t l = 0U; l < Lanes; ++l)
+            {
+                freeCount[l] += tile[l] == NoneValue ? 1U : 0U;
+            }
+        }
+    }
+}
+
+void FeatureExtractor::extractRegions() noexcept
+{
+    // Every free tile starts as its own region, then takes the smallest label around it
+    // until no lane changes; the sweeps alternate direction so long corridors settle fast
+    for (uint8_t t = 0U; t < MapTiles; ++t)
+    {
+        for (uint8_t l = 0U; l < Lanes; ++l)
+        {
+            m_regions[t][l] = m_tiles[t][l] == NoneValue ? t : NoRegion;
+        }
+    }
+    auto relax = [this](uint8_t t)
+    {
+        const LaneBytes& tile = m_tiles[t];
+        const LaneBytes& up = m_regions[t - MapCols];
+        const LaneBytes& left = m_regions[t - 1];
+        const LaneBytes& down = m_regions[t + MapCols];
+        const LaneBytes& right = m_regions[t + 1];
+        LaneBytes& region = m_regions[t];
+        uint8_t changed {0U};
+        for (uint8_t l = 0U; l < Lanes; ++l)
+        {
+            // Plain selects, as std::min returns references the vectorizer can't follow
+            uint8_t vertical = up[l] < down[l] ? up[l] : down[l];
+            uint8_t horizontal = left[l] < right[l] ? left[l] : right[l];
+            uint8_t current = region[l];
+            uint8_t label = vertical < horizontal ? vertical : horizontal;
+            label = label < current ? label : current;
+            label = tile[l] == NoneValue ? label : NoRegion;
+            changed |= label ^ current;
+            region[l] = label;
+        }
+        return changed != 0U;
+    };
+    bool isChanged {true};
+    while (isChanged)
+    {
+        isChanged = false;
+        for (uint8_t i = 1U; i <= BoardSize; ++i)
+        {
+            for (uint8_t j = 1U; j <= BoardSize; ++j)
+            {
+                isChanged |= relax(tileIndex(i, j));
+            }
+        }
+        for (uint8_t i = BoardSize; i > 0U; --i)
+        {
+            for (uint8_t j = BoardSize; j > 0U; --j)
+            {
+                isChanged |= relax(tileIndex(i, j));
+            }
+        }
+    }
+
+    std::array<std::array<uint8_t, MapTiles>, Lanes> sizes {};
+    for (uint8_t t = 0U; t < MapTiles; ++t)
+    {
+        for (uint8_t l = 0U; l < Lanes; ++l)
+        {
+            uint8_t label = m_regions[t][l];
+            if (label != NoRegion)
+            {
+                ++sizes[l][label];
+            }
+        }
+    }
+
+    for (uint8_t i = 1U; i <= BoardSize; ++i)
+    {
+        for (uint8_t j = 1U; j <= BoardSize; ++j)
+        {
+            uint8_t t = tileIndex(i, j);
+            LaneBytes& plane = m_features[RegionFeature + (i - 1) * BoardSize + (j - 1)];
+            const uint8_t neighbours[4] { static_cast<uint8_t>(t - MapCols), static_cast<uint8_t>(t - 1),
+                                          static_cast<uint8_t>(t + MapCols), static_cast<uint8_t>(t + 1) };
+            for (uint8_t l = 0U; l < Lanes; ++l)
+            {
+                uint8_t label = m_regions[t][l];
+                if (label != NoRegion)
+                {
+                    plane[l] = sizes[l][label];
+                    continue;
+                }
+                // A ball reaches every region it touches, each counted once
+                uint8_t touching[4];
+                uint8_t touchingCount {0U};
+                uint8_t reachable {0U};
+                for (uint8_t n : neighbours)
+                {
+                    uint8_t neighbourLabel = m_regions[n][l];
+                    if (neighbourLabel != NoRegion && std::find(touching, touching + touchingCount, neighbourLabel) == touching + touchingCount)
+                    {
+                        touching[touchingCount++] = neighbourLabel;
+                        reachable += sizes[l][neighbourLabel];
+                    }
+                }
+                plane[l] = reachable;
+            }
+        }
+    }
+}
+
+void FeatureExtractor::extractSpans() noexcept
+{
+    static constexpr int8_t Directions[DirectionsCount][2] { {0, 1}, {1, 1}, {1, 0}, {1, -1} };
+
+    LaneBytes active;
+    for (uint8_t direction = 0U; direction < DirectionsCount; ++direction)
+    {
+        for (uint8_t i = 1U; i <= BoardSize; ++i)
+        {
+            for (uint8_t j = 1U; j <= BoardSize; ++j)
+            {
+                const LaneBytes& colour = m_tiles[tileIndex(i, j)];
+                LaneBytes& span = m_features[SpanFeature + direction * Cells + (i - 1) * BoardSize + (j - 1)];
+                for (uint8_t l = 0U; l < Lanes; ++l)
+                {
+                    span[l] = colour[l] < ColoursCount ? 1U : 0U;
+                }
+                for (int sign = -1; sign <= 1; sign += 2)
+                {
+                    for (uint8_t l = 0U; l < Lanes; ++l)
+                    {
+                        active[l] = colour[l] < ColoursCount ? 1U : 0U;
+                    }
+                    // The walls match neither a colour nor a free tile, so every walk ends at the border
+                    int r = i + sign * Directions[direction][0];
+                    int c = j + sign * Directions[direction][1];
+                    while (r > 0 && r <= BoardSize && c > 0 && c <= BoardSize)
+                    {
+                        const LaneBytes& tile = m_tiles[tileIndex(r, c)];
+                        for (uint8_t l = 0U; l < Lanes; ++l)
+                        {
+                            active[l] &= (tile[l] == colour[l] || tile[l] == NoneValue) ? 1U : 0U;
+                            span[l] += active[l];
+                        }
+                        r += sign * Directions[direction][0];
+                        c += sign * Directions[direction][1];
+                    }
+                }
+            }
+        }
+    }
+}
+
+}
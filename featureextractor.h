@@ -0,0 +1,71 @@
+#ifndef FEATUREEXTRACTOR_H
+#define FEATUREEXTRACTOR_H
+
+#include <cstdint>
+#include <array>
+#include <vector>
+
+#include "gamemap.h"
+
+namespace Qoolkie
+{
+
+// Dense features of up to 32 boards at once, for training move evaluation models.
+// Every feature is one byte per board:
+//  - one occupancy plane per colour, 1 where the tile holds that colour
+//  - the region plane: for a free tile the size of its free region, for a ball the
+//    number of tiles it can be moved to
+//  - one open span plane per line direction: for a ball, the longest stretch through
+//    it holding only its colour or free tiles, 0 on free tiles
+//  - the number of free tiles
+// Boards are kept lane-per-board like in BatchEvaluator, so every step of the
+// extraction handles the same tile of all boards in one loop over 32 bytes, which
+// the compiler turns into SIMD code (see Kulki.pro).
+class FeatureExtractor
+{
+public:
+    static constexpr uint8_t Lanes {32};
+    static constexpr uint8_t BoardSize {GameMap::Rules::BoardSize};
+    static constexpr uint8_t Cells {BoardSize * BoardSize};
+    static constexpr uint8_t ColoursCount {GameMap::Rules::ColoursCount};
+    static constexpr uint8_t DirectionsCount {4};
+
+    static constexpr uint16_t OccupancyFeature {0};
+    static constexpr uint16_t RegionFeature {OccupancyFeature + ColoursCount * Cells};
+    static constexpr uint16_t SpanFeature {RegionFeature + Cells};
+    static constexpr uint16_t FreeCountFeature {SpanFeature + DirectionsCount * Cells};
+    static constexpr uint16_t FeaturesCount {FreeCountFeature + 1};
+
+    using LaneBytes = std::array<uint8_t, Lanes>;
+
+    FeatureExtractor();
+
+    void clear() noexcept;
+    uint8_t getLaneCount() const noexcept;
+    uint8_t addBoard(const GameMap& map);
+    void extract() noexcept;
+
+    // The feature for every lane; lanes beyond getLaneCount() are unspecified
+    const LaneBytes& getFeature(uint16_t feature) const noexcept;
+    void copyFeatures(uint8_t lane, uint8_t* features) const noexcept;
+
+private:
+    static constexpr uint8_t MapCols {BoardSize + 2};
+    static constexpr uint8_t MapTiles {MapCols * MapCols};
+    static constexpr uint8_t NoRegion {0xFF};
+
+    uint8_t tileIndex(uint8_t rowIdx, uint8_t colIdx) const noexcept;
+    void extractOccupancy() noexcept;
+    void extractRegions() noexcept;
+    void extractSpans() noexcept;
+
+    // Walls around the board, as in GameMap, so neighbours never need a bounds check
+    alignas(32) std::array<LaneBytes, MapTiles> m_tiles;
+    alignas(32) std::array<LaneBytes, MapTiles> m_regions;
+    std::vector<LaneBytes> m_features;
+    uint8_t m_laneCount {0U};
+};
+
+}
+
+#endif
@@ -0,0 +1,378 @@
+#include "featurestore.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+#include "gamepool.h"
+
+namespace Qoolkie
+{
+
+constexpr uint32_t FeatureWriter::DefaultRowsPerGroup;
+
+namespace
+{
+
+constexpr uint32_t FeatureMagic {0x41454651}; // "QFEA"
+constexpr uint32_t FeatureVersion {1U};
+constexpr uint32_t HeaderBytes {64U};
+constexpr uint32_t GroupAlignment {64U};
+constexpr uint16_t OutcomeColumnsCount {5U};
+constexpr uint8_t OutcomeWidths[OutcomeColumnsCount] {1U, 1U, 2U, 4U, 2U};
+constexpr uint16_t OutcomeBytes {10U};
+constexpr uint16_t RowBytes {FeatureExtractor::FeaturesCount + OutcomeBytes};
+// Rows are collected row by row and moved into the columns 64 at a time, so every
+// column receives a whole cache line at once
+constexpr uint32_t StagingRows {64U};
+// Same player stream as the tournament, so exported games replay its greedy games
+constexpr uint64_t PlayerSeedSalt {0xA5A5A5A55A5A5A5AULL};
+
+void storeLE(uchar* target, uint64_t value, uint8_t width) noexcept
+{
+    for (uint8_t i = 0U; i < width; ++i)
+    {
+        target[i] = static_cast<uchar>(value >> (8U * i));
+    }
+}
+
+uint64_t loadLE(const uchar* source, uint8_t width) noexcept
+{
+    uint64_t value {0U};
+    for (uint8_t i = 0U; i < width; ++i)
+    {
+        value |= static_cast<uint64_t>(source[i]) << (8U * i);
+    }
+    return value;
+}
+
+// Bytes of a row in front of the column, which is also where the column starts in a group in units of rows
+uint16_t getColumnOffset(uint16_t column) noexcept
+{
+    if (column < FeatureExtractor::FeaturesCount)
+    {
+        return column;
+    }
+    uint16_t offset {FeatureExtractor::FeaturesCount};
+    for (uint16_t i = FeatureExtractor::FeaturesCount; i < column; ++i)
+    {
+        offset += OutcomeWidths[i - FeatureExtractor::FeaturesCount];
+    }
+    return offset;
+}
+
+}
+
+FeatureWriter::FeatureWriter(const QString& filePath, uint32_t rowsPerGroup) : m_file(filePath), m_rowsPerGroup(rowsPerGroup)
+{
+    if (rowsPerGroup == 0U || rowsPerGroup % GroupAlignment != 0U)
+    {
+        throw std::runtime_error("Rows per group must be a multiple of 64");
+    }
+    if (!m_file.open(QIODevice::WriteOnly))
+    {
+        throw std::runtime_error("Could not create feature file");
+    }
+    std::array<uchar, HeaderBytes> header {};
+    if (m_file.write(reinterpret_cast<const char*>(header.data()), header.size()) != HeaderBytes)
+    {
+        throw std::runtime_error("Could not write feature file");
+    }
+    m_group.assign(static_cast<size_t>(m_rowsPerGroup) * RowBytes, 0U);
+    m_staging.reserve(StagingRows * RowBytes);
+}
+
+uint64_t FeatureWriter::getRowsCount() const noexcept
+{
+    return m_rowsCount;
+}
+
+void FeatureWriter::append(const uint8_t* features, const TurnOutcome& outcome)
+{
+    size_t row = m_staging.size();
+    m_staging.resize(row + RowBytes);
+    uchar* target = m_staging.data() + row;
+    std::memcpy(target, features, FeatureExtractor::FeaturesCount);
+    target += FeatureExtractor::FeaturesCount;
+    storeLE(target, outcome.move.fromRow * FeatureExtractor::BoardSize + outcome.move.fromCol, 1U);
+    storeLE(target + 1, outcome.move.destRow * FeatureExtractor::BoardSize + outcome.move.destCol, 1U);
+    storeLE(target + 2, outcome.gain, 2U);
+    storeLE(target + 4, outcome.finalScore, 4U);
+    storeLE(target + 8, outcome.movesLeft, 2U);
+    ++m_rowsCount;
+
+    if (m_staging.size() == StagingRows * RowBytes)
+    {
+        flushStaging();
+    }
+}
+
+void FeatureWriter::flushStaging()
+{
+    uint32_t stagedRows = static_cast<uint32_t>(m_staging.size() / RowBytes);
+    for (uint16_t column = 0U; column < FeatureExtractor::FeaturesCount + OutcomeColumnsCount; ++column)
+    {
+        uint8_t width = FeatureReader::getColumnWidth(column);
+        uint16_t offset = getColumnOffset(column);
+        uchar* target = m_group.data() + static_cast<size_t>(offset) * m_rowsPerGroup + static_cast<size_t>(m_groupRows) * width;
+        const uchar* source = m_staging.data() + offset;
+        for (uint32_t row = 0U; row < stagedRows; ++row)
+        {
+            std::memcpy(target + row * width, source + row * RowBytes, width);
+        }
+    }
+    m_staging.clear();
+    m_groupRows += stagedRows;
+    if (m_groupRows == m_rowsPerGroup)
+    {
+        flushGroup();
+    }
+}
+
+void FeatureWriter::flushGroup()
+{
+    if (m_file.write(reinterpret_cast<const char*>(m_group.data()), m_group.size()) != static_cast<qint64>(m_group.size()))
+    {
+        throw std::runtime_error("Could not write feature file");
+    }
+    std::fill(m_group.begin(), m_group.end(), 0U);
+    m_groupRows = 0U;
+    ++m_groupsCount;
+}
+
+void FeatureWriter::close()
+{
+    if (m_isClosed)
+    {
+        return;
+    }
+    if (!m_staging.empty())
+    {
+        flushStaging();
+    }
+    if (m_groupRows != 0U)
+    {
+        flushGroup();
+    }
+
+    std::array<uchar, HeaderBytes> header {};
+    storeLE(header.data(), FeatureMagic, 4U);
+    storeLE(header.data() + 4, FeatureVersion, 4U);
+    storeLE(header.data() + 8, m_rowsPerGroup, 4U);
+    storeLE(header.data() + 12, FeatureExtractor::FeaturesCount, 2U);
+    storeLE(header.data() + 14, OutcomeColumnsCount, 2U);
+    storeLE(header.data() + 16, m_rowsCount, 8U);
+    storeLE(header.data() + 24, m_groupsCount, 8U);
+    if (!m_file.seek(0) || m_file.write(reinterpret_cast<const char*>(header.data()), header.size()) != HeaderBytes)
+    {
+        throw std::runtime_error("Could not write feature file");
+    }
+    if (!m_file.commit())
+    {
+        throw std::runtime_error("Could not replace feature file");
+    }
+    m_isClosed = true;
+}
+
+FeatureReader::FeatureReader(const QString& filePath) : m_file(filePath)
+{
+    if (!m_file.open(QIODevice::ReadOnly) || m_file.size() < HeaderBytes)
+    {
+        throw std::runtime_error("Could not open feature file");
+    }
+    m_data = m_file.map(0, m_file.size());
+    if (!m_data)
+    {
+        throw std::runtime_error("Could not map feature file");
+    }
+
+    m_rowsPerGroup = static_cast<uint32_t>(loadLE(m_data + 8, 4U));
+    m_rowsCount = loadLE(m_data + 16, 8U);
+    m_groupsCount = loadLE(m_data + 24, 8U);
+    uint64_t groupBytes = static_cast<uint64_t>(m_rowsPerGroup) * RowBytes;
+    if (loadLE(m_data, 4U) != FeatureMagic || loadLE(m_data + 4, 4U) != FeatureVersion ||
+        loadLE(m_data + 12, 2U) != FeatureExtractor::FeaturesCount || loadLE(m_data + 14, 2U) != OutcomeColumnsCount ||
+        m_rowsPerGroup == 0U || m_rowsCount > m_groupsCount * m_rowsPerGroup ||
+        static_cast<uint64_t>(m_file.size()) != HeaderBytes + m_groupsCount * groupBytes)
+    {
+        m_file.unmap(const_cast<uchar*>(m_data));
+        throw std::runtime_error("Corrupt feature file");
+    }
+}
+
+FeatureReader::~FeatureReader()
+{
+    m_file.unmap(const_cast<uchar*>(m_data));
+}
+
+uint8_t FeatureReader::getColumnWidth(uint16_t column) noexcept
+{
+    return column < FeatureExtractor::FeaturesCount ? 1U : OutcomeWidths[column - FeatureExtractor::FeaturesCount];
+}
+
+uint16_t FeatureReader::getOutcomeColumn(OutcomeColumn column) noexcept
+{
+    return FeatureExtractor::FeaturesCount + static_cast<uint16_t>(column);
+}
+
+uint64_t FeatureReader::getRowsCount() const noexcept
+{
+    return m_rowsCount;
+}
+
+uint64_t FeatureReader::getGroupsCount() const noexcept
+{
+    return m_groupsCount;
+}
+
+uint32_t FeatureReader::getRowsPerGroup() const noexcept
+{
+    return m_rowsPerGroup;
+}
+
+uint32_t FeatureReader::getGroupRows(uint64_t group) const noexcept
+{
+    uint64_t first = group * m_rowsPerGroup;
+    return first >= m_rowsCount ? 0U : static_cast<uint32_t>(std::min<uint64_t>(m_rowsCount - first, m_rowsPerGroup));
+}
+
+const uint8_t* FeatureReader::getColumn(uint64_t group, uint16_t column) const noexcept
+{
+    return m_data + HeaderBytes + group * m_rowsPerGroup * RowBytes + static_cast<uint64_t>(getColumnOffset(column)) * m_rowsPerGroup;
+}
+
+TurnOutcome FeatureReader::getOutcome(uint64_t row) const noexcept
+{
+    uint64_t group = row / m_rowsPerGroup;
+    uint32_t rowIdx = static_cast<uint32_t>(row % m_rowsPerGroup);
+    auto load = [this, group, rowIdx](OutcomeColumn column)
+    {
+        uint16_t columnIdx = getOutcomeColumn(column);
+        uint8_t width = getColumnWidth(columnIdx);
+        return loadLE(getColumn(group, columnIdx) + rowIdx * width, width);
+    };
+    uint8_t from = static_cast<uint8_t>(load(OutcomeColumn::FromCell));
+    uint8_t dest = static_cast<uint8_t>(load(OutcomeColumn::DestCell));
+    TurnOutcome outcome;
+    outcome.move = Move {static_cast<uint8_t>(from / FeatureExtractor::BoardSize), static_cast<uint8_t>(from % FeatureExtractor::BoardSize),
+                         static_cast<uint8_t>(dest / FeatureExtractor::BoardSize), static_cast<uint8_t>(dest % FeatureExtractor::BoardSize)};
+    outcome.gain = static_cast<uint16_t>(load(OutcomeColumn::Gain));
+    outcome.finalScore = static_cast<uint32_t>(load(OutcomeColumn::FinalScore));
+    outcome.movesLeft = static_cast<uint16_t>(load(OutcomeColumn::MovesLeft));
+    return outcome;
+}
+
+int runFeatureExport(const QString& filePath, uint32_t games, uint64_t baseSeed, ColoursUsed colours)
+{
+    struct LaneGame
+    {
+        SessionHandle handle;
+        Rng rng;
+        bool isActive;
+        std::vector<uint8_t> features;
+        std::vector<TurnOutcome> outcomes;
+    };
+
+    QTextStream out(stdout);
+    QElapsedTimer timer;
+    timer.start();
+
+    FeatureExtractor extractor;
+    FeatureWriter writer {filePath};
+    GamePool pool {FeatureExtractor::Lanes};
+    GreedyPlayer player;
+    std::vector<LaneGame> lanes(FeatureExtractor::Lanes);
+    std::vector<GameMap> maps(FeatureExtractor::Lanes);
+    std::vector<uint8_t> batchLanes(FeatureExtractor::Lanes);
+    uint32_t startedGames {0U};
+
+    auto startGame = [&](LaneGame& lane)
+    {
+        lane.isActive = startedGames < games;
+        if (lane.isActive)
+        {
+            uint64_t seed = baseSeed + startedGames++;
+            lane.handle = pool.acquire(colours, seed);
+            lane.rng = Rng {seed ^ PlayerSeedSalt};
+            lane.features.clear();
+            lane.outcomes.clear();
+        }
+    };
+    // Outcomes are only known at the end, so the game's rows are written then
+    auto finishGame = [&](LaneGame& lane)
+    {
+        uint32_t finalScore = pool.getScore(lane.handle);
+        uint16_t movesCount = static_cast<uint16_t>(lane.outcomes.size());
+        for (uint16_t i = 0U; i < movesCount; ++i)
+        {
+            TurnOutcome& outcome = lane.outcomes[i];
+            outcome.finalScore = finalScore;
+            outcome.movesLeft = movesCount - i;
+            writer.append(lane.features.data() + static_cast<size_t>(i) * FeatureExtractor::FeaturesCount, outcome);
+        }
+        pool.release(lane.handle);
+        startGame(lane);
+    };
+
+    for (auto&& lane : lanes)
+    {
+        startGame(lane);
+    }
+
+    // Every step extracts the positions of all running games as one batch
+    bool isAnyActive {true};
+    while (isAnyActive)
+    {
+        extractor.clear();
+        for (uint8_t i = 0U; i < lanes.size(); ++i)
+        {
+            if (lanes[i].isActive)
+            {
+                uint8_t batchLane = extractor.getLaneCount();
+                pool.loadMap(lanes[i].handle, maps[batchLane]);
+                extractor.addBoard(maps[batchLane]);
+                batchLanes[batchLane] = i;
+            }
+        }
+        extractor.extract();
+
+        isAnyActive = false;
+        for (uint8_t batchLane = 0U; batchLane < extractor.getLaneCount(); ++batchLane)
+        {
+            LaneGame& lane = lanes[batchLanes[batchLane]];
+            Move move;
+            if (player.chooseMove(maps[batchLane], lane.rng, move))
+            {
+                MoveResult result = pool.move(lane.handle, move.fromRow, move.fromCol, move.destRow, move.destCol);
+                if (result.isLegal)
+                {
+                    lane.features.resize(lane.features.size() + FeatureExtractor::FeaturesCount);
+                    extractor.copyFeatures(batchLane, lane.features.data() + lane.features.size() - FeatureExtractor::FeaturesCount);
+                    lane.outcomes.push_back(TurnOutcome {move, result.gain, 0U, 0U});
+                    if (!result.isGameOver)
+                    {
+                        isAnyActive = true;
+                        continue;
+                    }
+                }
+            }
+            finishGame(lane);
+            isAnyActive = isAnyActive || lane.isActive;
+        }
+    }
+    writer.close();
+
+    qint64 elapsed = std::max<qint64>(timer.elapsed(), 1);
+    out << "Exported " << writer.getRowsCount() << " positions of " << games << " games to " << filePath << " in "
+        << elapsed << " ms (" << qRound64(writer.getRowsCount() * 1000.0 / elapsed) << " positions/s)" << endl;
+
+    FeatureReader reader {filePath};
+    out << reader.getGroupsCount() << " row groups of " << reader.getRowsPerGroup() << " rows, "
+        << FeatureExtractor::FeaturesCount << " feature columns" << endl;
+    return 0;
+}
+
+}
@@ -0,0 +1,102 @@
+#ifndef FEATURESTORE_H
+#define FEATURESTORE_H
+
+#include <cstdint>
+#include <vector>
+#include <QFile>
+#include <QSaveFile>
+#include <QString>
+
+#include "featureextractor.h"
+#include "player.h"
+
+namespace Qoolkie
+{
+
+// What followed a position: the move played from it, what that move scored and how
+// the game ended
+struct TurnOutcome
+{
+    Move move;
+    uint16_t gain;
+    uint32_t finalScore;
+    uint16_t movesLeft;
+};
+
+// Columns after the FeatureExtractor::FeaturesCount feature columns
+enum class OutcomeColumn : uint8_t
+{
+    FromCell,    // uint8_t, row * 9 + column
+    DestCell,    // uint8_t
+    Gain,        // uint16_t
+    FinalScore,  // uint32_t
+    MovesLeft    // uint16_t
+};
+
+// Feature rows in a columnar file meant to be memory-mapped by training jobs. After
+// a 64-byte header come row groups of the same size: every column of the group's
+// rows is stored contiguously, one column after the other, little-endian. The last
+// group is padded to full size, the header holds the real number of rows. As the
+// rows per group are a multiple of 64, every column starts 64-byte aligned.
+class FeatureWriter
+{
+public:
+    static constexpr uint32_t DefaultRowsPerGroup {4096U};
+
+    explicit FeatureWriter(const QString& filePath, uint32_t rowsPerGroup = DefaultRowsPerGroup);
+    FeatureWriter(const FeatureWriter&) = delete;
+    FeatureWriter& operator=(const FeatureWriter&) = delete;
+
+    // features holds FeatureExtractor::FeaturesCount values, as from copyFeatures()
+    void append(const uint8_t* features, const TurnOutcome& outcome);
+    // Only a closed file is complete, it replaces filePath then in one atomic rename;
+    // a writer destroyed unclosed leaves filePath as it was
+    void close();
+    uint64_t getRowsCount() const noexcept;
+
+private:
+    void flushStaging();
+    void flushGroup();
+
+    QSaveFile m_file;
+    uint32_t m_rowsPerGroup;
+    std::vector<uint8_t> m_staging;
+    std::vector<uint8_t> m_group;
+    uint32_t m_groupRows {0U};
+    uint64_t m_rowsCount {0U};
+    uint64_t m_groupsCount {0U};
+    bool m_isClosed {false};
+};
+
+class FeatureReader
+{
+public:
+    explicit FeatureReader(const QString& filePath);
+    ~FeatureReader();
+    FeatureReader(const FeatureReader&) = delete;
+    FeatureReader& operator=(const FeatureReader&) = delete;
+
+    static uint8_t getColumnWidth(uint16_t column) noexcept;
+    static uint16_t getOutcomeColumn(OutcomeColumn column) noexcept;
+
+    uint64_t getRowsCount() const noexcept;
+    uint64_t getGroupsCount() const noexcept;
+    uint32_t getRowsPerGroup() const noexcept;
+    uint32_t getGroupRows(uint64_t group) const noexcept;
+    // getRowsPerGroup() values of getColumnWidth(column) bytes each
+    const uint8_t* getColumn(uint64_t group, uint16_t column) const noexcept;
+    TurnOutcome getOutcome(uint64_t row) const noexcept;
+
+private:
+    QFile m_file;
+    const uchar* m_data {nullptr};
+    uint32_t m_rowsPerGroup {0U};
+    uint64_t m_rowsCount {0U};
+    uint64_t m_groupsCount {0U};
+};
+
+int runFeatureExport(const QString& filePath, uint32_t games, uint64_t baseSeed, ColoursUsed colours);
+
+}
+
+#endif
@@ -7,18 +7,31 @@ namespace Qoolkie
 {
 
 constexpr char Game::ResourcesPath[];
-constexpr char Game::highscores5FileName[];
-constexpr char Game::highscores7FileName[];
-constexpr std::array<TileContent, 7> Game::ContentsPot;
+constexpr TileContent Game::ContentsPot[];
 
 void Game::start(ColoursUsed colours)
+{
+    start(colours, static_cast<uint64_t>(rand()) << 32 | static_cast<uint64_t>(rand()));
+}
+
+void Game::start(ColoursUsed colours, uint64_t seed)
 {
     m_map.clearAllTiles();
+    m_history.clear();
+    m_rng = Rng {seed};
+    m_isGameOver = false;
 
     m_coloursInGame = colours;
     m_currentGain = static_cast<uint8_t>(m_coloursInGame);
     m_score = 0U;
+    m_turns = 0U;
+
+    // The first spawns are no turn of their own, so they're only recorded for the feed
+    TurnDiff spawns;
+    m_turn = m_feed ? &spawns : nullptr;
     generateQoolkies();
+    m_turn = nullptr;
+    publishTurn(SpectatorEventKind::Start, spawns);
 }
 
 void Game::generateQoolkies()
@@ -30,15 +43,14 @@ void Game::generateQoolkies()
     std::vector<std::pair<uint8_t, uint8_t>> freeTiles = m_map.getFreeTiles();
     std::map<std::pair<uint8_t, uint8_t>, TileContent> generatedTiles;
 
-    static constexpr uint8_t newTilesNb {3U};
-    for (uint8_t i = 0U; i < newTilesNb; ++i)
+    for (uint8_t i = 0U; i < Rules::SpawnsPerTurn; ++i)
     {
         if (!m_map.isAnyFreeTile())
         {
             break;
         }
-        uint8_t tileIdx = rand() % freeTiles.size();
-        uint8_t contentIdx = rand() % static_cast<uint8_t>(m_coloursInGame);
+        uint8_t tileIdx = m_rng.nextBelow(static_cast<uint32_t>(freeTiles.size()));
+        uint8_t contentIdx = m_rng.nextBelow(static_cast<uint8_t>(m_coloursInGame));
 
         std::pair<uint8_t, uint8_t> tile = freeTiles.at(tileIdx);
         freeTiles.erase(freeTiles.begin() + tileIdx);
@@ -46,14 +58,18 @@ void Game::generateQoolkies()
         TileContent content = ContentsPot[contentIdx];
         generatedTiles[tile] = content;
 
-        m_map.setTileContent(tile.first, tile.second, content);
+        setTile(tile.first, tile.second, content);
         emit qoolkieGenerated(tile.first - 1, tile.second - 1, content);
     }
+    if (m_statistics)
+    {
+        m_statistics->recordSpawn(static_cast<uint8_t>(generatedTiles.size()));
+    }
 
     for (auto&& tile : generatedTiles)
     {
         auto ret = m_map.checkForScore(tile.first.first, tile.first.second, tile.second);
-        if (ret.size() >= 5)
+        if (Rules::isScoringLine(ret.size()))
         {
             doScore(ret);
         }
@@ -62,13 +78,21 @@ void Game::generateQoolkies()
 
 void Game::saveHighscore(const QString &userName) const
 {
-    m_highscore.save(m_coloursInGame == ColoursUsed::Five ? highscores5FileName : highscores7FileName,
-                     userName.toStdString(), m_score);
+    getLeaderboard().insert(m_coloursInGame, userName.toStdString(), m_score);
+}
+
+SharedLeaderboard& Game::getLeaderboard() const
+{
+    if (!m_leaderboard)
+    {
+        m_leaderboard.reset(new SharedLeaderboard(SharedLeaderboard::getDefaultPath()));
+    }
+    return *m_leaderboard;
 }
 
 QString Game::getHighscores(ColoursUsed coloursUsedInGame) const
 {
-    auto highscores = m_highscore.loadHighscores(coloursUsedInGame == ColoursUsed::Five ? highscores5FileName : highscores7FileName);
+    auto highscores = getLeaderboard().snapshot(coloursUsedInGame);
 
     QString scores;
     uint8_t counter {1U};
@@ -90,14 +114,24 @@ void Game::preProcessNextTurn()
     generateQoolkies();
     if (!m_map.isAnyFreeTile())
     {
-        emit gameOver();
+        finishGame();
+    }
+}
+
+void Game::finishGame()
+{
+    m_isGameOver = true;
+    if (m_statistics)
+    {
+        m_statistics->recordGameOver(m_score, m_turns);
     }
+    emit gameOver();
 }
 
 uint32_t Game::postProcessTurn(uint8_t destX, uint8_t destY)
 {
     auto ret = m_map.checkForScore(destX, destY, m_map.getTileContent(destX, destY));
-    if (ret.size() >= 5)
+    if (Rules::isScoringLine(ret.size()))
     {
         return doScore(ret);
     }
@@ -110,49 +144,84 @@ uint32_t Game::doScore(std::vector<std::pair<uint8_t, uint8_t>> tiles)
     {
         uint8_t x = tile.first;
         uint8_t y = tile.second;
-        m_map.setTileContent(x, y, TileContent::None);
+        setTile(x, y, TileContent::None);
         emit tileCleared(x - 1, y - 1);
     }
 
-    uint16_t gain = calculateGain(tiles.size());
+    if (m_statistics)
+    {
+        m_statistics->recordLine(tiles);
+    }
+
+    uint16_t gain = Rules::calculateGain(m_currentGain, tiles.size());
     m_score += gain;
     emit scoreChanged(m_score);
     return gain;
 }
 
-uint16_t Game::calculateGain(size_t ballsInRow) const noexcept
+void Game::setTile(uint8_t x, uint8_t y, TileContent content)
 {
-    uint16_t gain = m_currentGain;
-    if (ballsInRow == 6)
-    {
-        return gain * 2;
-    }
-    else if (ballsInRow == 7)
+    if (m_turn)
     {
-        return gain * 3;
+        m_turn->addChange(x, y, m_map.getTileContent(x, y), content);
     }
-    else if (ballsInRow > 7)
-    {
-        return gain * 4;
-    }
-    return gain;
+    m_map.setTileContent(x, y, content);
 }
 
 void Game::moveQoolkie(uint8_t destX, uint8_t destY)
 {
+    TurnDiff& turn = m_history.beginTurn();
+    turn.scoreBefore = m_score;
+    turn.rngBefore = m_rng.getState();
+    turn.wasGameOver = m_isGameOver;
+    m_turn = &turn;
+
     TileContent content = m_map.getTileContent(m_ballXPos, m_ballYPos);
 
-    m_map.setTileContent(m_ballXPos, m_ballYPos, TileContent::None);
+    // The route only matters to an animating view, simulated games skip the search
+    if (receivers(SIGNAL(ballMoved(Qoolkie::TilePath,Qoolkie::TileContent))) > 0)
+    {
+        TilePath path = m_map.findShortestPath(m_ballXPos, m_ballYPos, destX, destY);
+        for (auto&& tile : path)
+        {
+            --tile.first;
+            --tile.second;
+        }
+        emit ballMoved(path, content);
+    }
+
+    setTile(m_ballXPos, m_ballYPos, TileContent::None);
     emit qoolkieGenerated(m_ballXPos - 1, m_ballYPos - 1, TileContent::None);
 
-    m_map.setTileContent(destX, destY, content);
+    setTile(destX, destY, content);
     emit qoolkieGenerated(destX - 1, destY - 1, content);
 
+    ++m_turns;
     uint32_t gain = postProcessTurn(destX, destY);
     if (gain == 0U)
     {
         preProcessNextTurn();
     }
+    // Whatever is played from a decided position, the score stays as it is
+    if (!m_isGameOver)
+    {
+        PositionVerdict verdict = classifyPosition(m_map);
+        if (verdict.state != PositionState::Live)
+        {
+            emit gameDecided(verdict.state, verdict.turnsLeft);
+            finishGame();
+        }
+    }
+    if (m_statistics)
+    {
+        m_statistics->recordTurn(m_map);
+    }
+
+    m_turn = nullptr;
+    turn.scoreAfter = m_score;
+    turn.rngAfter = m_rng.getState();
+    turn.isGameOver = m_isGameOver;
+    publishTurn(SpectatorEventKind::Turn, turn);
 }
 
 void Game::tileClicked(uint8_t rowIdx, uint8_t colIdx)
@@ -180,6 +249,136 @@ void Game::tileClicked(uint8_t rowIdx, uint8_t colIdx)
     }
 }
 
+bool Game::moveBall(uint8_t fromRow, uint8_t fromCol, uint8_t destRow, uint8_t destCol)
+{
+    if (fromRow >= GameMapRows || fromCol >= GameMapCols || destRow >= GameMapRows || destCol >= GameMapCols)
+    {
+        return false;
+    }
+    uint8_t x = fromRow + 1;
+    uint8_t y = fromCol + 1;
+    uint8_t destX = destRow + 1;
+    uint8_t destY = destCol + 1;
+    if (!m_map.isTileOccupied(x, y) || m_map.isTileOccupied(destX, destY) || !m_map.findPath(x, y, destX, destY))
+    {
+        return false;
+    }
+
+    m_isBallClicked = false;
+    m_ballXPos = x;
+    m_ballYPos = y;
+    moveQoolkie(destX, destY);
+    return true;
+}
+
+const GameMap& Game::getMap() const noexcept
+{
+    return m_map;
+}
+
+uint32_t Game::getScore() const noexcept
+{
+    return m_score;
+}
+
+bool Game::isGameOver() const noexcept
+{
+    return m_isGameOver;
+}
+
+void Game::setStatistics(GameStatistics* statistics) noexcept
+{
+    m_statistics = statistics;
+}
+
+void Game::setSpectatorFeed(SpectatorFeed* feed) noexcept
+{
+    m_feed = feed;
+}
+
+bool Game::undo()
+{
+    // A finished game has had its score saved, and taking back its last turn would
+    // replay a lost position knowing what the restored generator spawns next
+    if (m_isGameOver)
+    {
+        return false;
+    }
+    const TurnDiff* turn = m_history.undo();
+    if (!turn)
+    {
+        return false;
+    }
+    turn->undo(m_map);
+    m_score = turn->scoreBefore;
+    m_rng.setState(turn->rngBefore);
+    m_isGameOver = turn->wasGameOver;
+    --m_turns;
+    showTurnDiff(*turn);
+    publishTurn(SpectatorEventKind::Undo, *turn);
+    return true;
+}
+
+bool Game::redo()
+{
+    const TurnDiff* turn = m_history.redo();
+    if (!turn)
+    {
+        return false;
+    }
+    turn->redo(m_map);
+    m_score = turn->scoreAfter;
+    m_rng.setState(turn->rngAfter);
+    m_isGameOver = turn->isGameOver;
+    ++m_turns;
+    showTurnDiff(*turn);
+    publishTurn(SpectatorEventKind::Redo, *turn);
+    return true;
+}
+
+bool Game::canUndo() const noexcept
+{
+    return !m_isGameOver && m_history.canUndo();
+}
+
+bool Game::canRedo() const noexcept
+{
+    return m_history.canRedo();
+}
+
+void Game::showTurnDiff(const TurnDiff& turn)
+{
+    // A selection made before undo/redo may point at a tile that has changed
+    if (m_isBallClicked)
+    {
+        m_isBallClicked = false;
+        emit qoolkieGenerated(m_ballXPos - 1, m_ballYPos - 1, m_map.getTileContent(m_ballXPos, m_ballYPos));
+    }
+    // Only the final state of each cell matters, so every changed cell is redrawn once
+    for (uint8_t i = 0U; i < turn.changesCount; ++i)
+    {
+        const CellChange& change = turn.changes[i];
+        TileContent content = m_map.getTileContent(change.row, change.col);
+        if (content == TileContent::None)
+        {
+            emit tileCleared(change.row - 1, change.col - 1);
+        }
+        else
+        {
+            emit qoolkieGenerated(change.row - 1, change.col - 1, content);
+        }
+    }
+    emit scoreChanged(m_score);
+}
+
+void Game::publishTurn(SpectatorEventKind kind, const TurnDiff& turn)
+{
+    if (m_feed)
+    {
+        m_feed->publish(kind, turn, m_score, m_turns, m_coloursInGame, m_isGameOver, m_map);
+    }
+}
+
 QString Game::convertContentToString(TileContent content) noexcept
 {
     switch (content)
@@ -3,21 +3,21 @@
 
 #include <cstdint>
 #include <array>
+#include <memory>
 #include <QObject>
 #include <QString>
 
+#include "deadposition.h"
 #include "gamemap.h"
-#include "highscore.h"
+#include "gamestatistics.h"
+#include "rng.h"
+#include "sharedleaderboard.h"
+#include "spectatorfeed.h"
+#include "turnhistory.h"
 
 namespace Qoolkie
 {
 
-enum class ColoursUsed : uint8_t
-{
-    Five = 5U,
-    Seven = 7U
-};
-
 class Game : public QObject
 {
     Q_OBJECT
@@ -27,43 +27,74 @@ public:
     static QString convertContentToString(TileContent content) noexcept;
 
     void start(ColoursUsed colours);
+    void start(ColoursUsed colours, uint64_t seed);
     void saveHighscore(const QString& userName) const;
     QString getHighscores(ColoursUsed coloursUsedInGame) const;
     void tileClicked(uint8_t row, uint8_t col);
+    bool moveBall(uint8_t fromRow, uint8_t fromCol, uint8_t destRow, uint8_t destCol);
+    const GameMap& getMap() const noexcept;
+    uint32_t getScore() const noexcept;
+    bool isGameOver() const noexcept;
+    void setStatistics(GameStatistics* statistics) noexcept;
+    // Every turn, undo and new game is published to the feed while one is set
+    void setSpectatorFeed(SpectatorFeed* feed) noexcept;
+    // Refused once the game is over
+    bool undo();
+    bool redo();
+    bool canUndo() const noexcept;
+    bool canRedo() const noexcept;
 
 signals:
     void qoolkieGenerated(uint8_t x, uint8_t y, Qoolkie::TileContent content);
+    void ballMoved(Qoolkie::TilePath path, Qoolkie::TileContent content);
     void focusChanged(uint8_t x, uint8_t y, Qoolkie::TileContent content);
     void scoreChanged(uint32_t score);
     void tileCleared(uint8_t x, uint8_t y);
+    // Emitted just before gameOver() when the game ends with free tiles left
+    void gameDecided(Qoolkie::PositionState state, uint8_t turnsLeft);
     void gameOver();
 
 private:
-    static constexpr uint8_t GameMapRows {9};
-    static constexpr uint8_t GameMapCols {9};
-    static constexpr char highscores5FileName[] = "highscores_5.json";
-    static constexpr char highscores7FileName[] = "highscores_7.json";
-    static constexpr std::array<TileContent, 7> ContentsPot { TileContent::Black, TileContent::Blue, TileContent::Green, TileContent::Pink,
-                                                              TileContent::Red, TileContent::Yellow };
+    using Rules = GameMap::Rules;
+
+    static constexpr uint8_t GameMapRows {Rules::BoardSize};
+    static constexpr uint8_t GameMapCols {Rules::BoardSize};
+    // Five-colour games draw from the first five, so Purple only comes with seven
+    static constexpr TileContent ContentsPot[] { TileContent::Black, TileContent::Blue, TileContent::Green, TileContent::Pink,
+                                                 TileContent::Red, TileContent::Yellow, TileContent::Purple };
+
+    static_assert(sizeof(ContentsPot) / sizeof(ContentsPot[0]) == Rules::ColoursCount, "Every colour of the rules needs a palette slot");
 
     void preProcessNextTurn();
     uint32_t postProcessTurn(uint8_t destX, uint8_t destY);
+    void finishGame();
 
     void generateQoolkies();
     void moveQoolkie(uint8_t destX, uint8_t destY);
+    void setTile(uint8_t x, uint8_t y, TileContent content);
+    SharedLeaderboard& getLeaderboard() const;
+    void showTurnDiff(const TurnDiff& turn);
+    void publishTurn(SpectatorEventKind kind, const TurnDiff& turn);
 
     uint32_t doScore(std::vector<std::pair<uint8_t, uint8_t>> tiles);
-    uint16_t calculateGain(size_t ballsInRow) const noexcept;
 
-    GameMap m_map {GameMapRows, GameMapCols};
-    Highscore m_highscore;
+    GameMap m_map;
+    // Opened on first use, simulated games never touch it
+    mutable std::unique_ptr<SharedLeaderboard> m_leaderboard;
+    Rng m_rng;
+    GameStatistics* m_statistics {nullptr};
+    SpectatorFeed* m_feed {nullptr};
+    TurnHistory m_history;
+    TurnDiff* m_turn {nullptr};
 
     uint32_t m_score {0U};
+    uint32_t m_turns {0U};
     int32_t m_currentGain {0};
     uint8_t m_ballXPos {0U};
     uint8_t m_ballYPos {0U};
     ColoursUsed m_coloursInGame {ColoursUsed::Five};
     bool m_isBallClicked {false};
+    bool m_isGameOver {false};
 };
 
 }
@@ -6,32 +6,57 @@
 namespace Qoolkie
 {
 
-GameMap::GameMap(uint8_t rows, uint8_t cols) : m_rows(rows + 2), m_cols(cols + 2),
-                                               m_map(m_rows, std::vector<TileContent>(m_cols, TileContent::None))
+template<typename GameRules>
+constexpr std::array<uint32_t, GameRules::LineLength + 1> BasicGameMap<GameRules>::LinePotentialWeights;
+template<typename GameRules>
+constexpr uint8_t BasicGameMap<GameRules>::PaddedSize;
+template<typename GameRules>
+constexpr uint16_t BasicGameMap<GameRules>::TilesCount;
+template<typename GameRules>
+constexpr uint8_t BasicGameMap<GameRules>::LineDirectionsCount;
+template<typename GameRules>
+constexpr uint8_t BasicGameMap<GameRules>::WindowCountBits;
+template<typename GameRules>
+constexpr uint8_t BasicGameMap<GameRules>::PendingTileFlag;
+
+namespace
+{
+
+constexpr std::array<std::pair<int8_t, int8_t>, 4> LineDirections { std::make_pair(0, 1), std::make_pair(1, 1),
+                                                                     std::make_pair(1, 0), std::make_pair(1, -1) };
+
+}
+
+template<typename GameRules>
+BasicGameMap<GameRules>::BasicGameMap()
 {
     defaultFillTiles();
 }
 
-uint8_t GameMap::getRowsCount() const noexcept
+template<typename GameRules>
+uint8_t BasicGameMap<GameRules>::getRowsCount() const noexcept
 {
-    return m_rows - 2;
+    return Rules::BoardSize;
 }
 
-uint8_t GameMap::getColsCount() const noexcept
+template<typename GameRules>
+uint8_t BasicGameMap<GameRules>::getColsCount() const noexcept
 {
-    return m_cols - 2;
+    return Rules::BoardSize;
 }
 
-void GameMap::clearAllTiles()
+template<typename GameRules>
+void BasicGameMap<GameRules>::clearAllTiles()
 {
     defaultFillTiles();
 }
 
-void GameMap::defaultFillTiles() noexcept
+template<typename GameRules>
+void BasicGameMap<GameRules>::defaultFillTiles() noexcept
 {
-    for (uint8_t i = 0U; i < m_rows; ++i)
+    for (uint8_t i = 0U; i < PaddedSize; ++i)
     {
-        for (uint8_t j = 0U; j < m_cols; ++j)
+        for (uint8_t j = 0U; j < PaddedSize; ++j)
         {
             if (i == 0U)
             {
@@ -41,11 +66,11 @@ void GameMap::defaultFillTiles() noexcept
             {
                 m_map[i][j] = TileContent::Wall;
             }
-            else if (i == (m_rows - 1))
+            else if (i == (PaddedSize - 1))
             {
                 m_map[i][j] = TileContent::Wall;
             }
-            else if (j == (m_cols - 1))
+            else if (j == (PaddedSize - 1))
             {
                 m_map[i][j] = TileContent::Wall;
             }
@@ -55,30 +80,126 @@ void GameMap::defaultFillTiles() noexcept
             }
         }
     }
+    std::fill(m_windows.begin(), m_windows.end(), 0U);
+    std::fill(m_windowTiles.begin(), m_windowTiles.end(), static_cast<uint8_t>(TileContent::None));
+    m_pendingCount = 0U;
+    m_linePotentials.fill(0U);
 }
 
-void GameMap::setTileContent(uint8_t rowIdx, uint8_t colIdx, TileContent content)
+template<typename GameRules>
+void BasicGameMap<GameRules>::setTileContent(uint8_t rowIdx, uint8_t colIdx, TileContent content)
 {
     m_map[rowIdx][colIdx] = content;
+    if (rowIdx > 0U && rowIdx < PaddedSize - 1 && colIdx > 0U && colIdx < PaddedSize - 1)
+    {
+        uint16_t tileIdx = (rowIdx - 1) * Rules::BoardSize + (colIdx - 1);
+        if ((m_windowTiles[tileIdx] & PendingTileFlag) == 0U)
+        {
+            m_windowTiles[tileIdx] |= PendingTileFlag;
+            m_pendingTiles[m_pendingCount++] = tileIdx;
+        }
+    }
+}
+
+template<typename GameRules>
+void BasicGameMap<GameRules>::updateLinePotential() noexcept
+{
+    for (uint16_t i = 0U; i < m_pendingCount; ++i)
+    {
+        uint16_t tileIdx = m_pendingTiles[i];
+        uint8_t rowIdx = tileIdx / Rules::BoardSize + 1;
+        uint8_t colIdx = tileIdx % Rules::BoardSize + 1;
+        TileContent oldContent = static_cast<TileContent>(m_windowTiles[tileIdx] & ~PendingTileFlag);
+        TileContent newContent = m_map[rowIdx][colIdx];
+        if (oldContent != newContent)
+        {
+            updateWindows(rowIdx, colIdx, oldContent, newContent);
+        }
+        m_windowTiles[tileIdx] = static_cast<uint8_t>(newContent);
+    }
+    m_pendingCount = 0U;
+}
+
+template<typename GameRules>
+void BasicGameMap<GameRules>::updateWindows(uint8_t rowIdx, uint8_t colIdx, TileContent oldContent, TileContent newContent) noexcept
+{
+    auto countBit = [](TileContent content)
+    {
+        return content == TileContent::None ? 0U : 1U << (static_cast<uint8_t>(content) * WindowCountBits);
+    };
+    const uint32_t oldBit = countBit(oldContent);
+    const uint32_t newBit = countBit(newContent);
+    constexpr int rows {Rules::BoardSize};
+    constexpr int cols {Rules::BoardSize};
+    constexpr size_t directionWindows {TilesCount};
+
+    // Only the windows through the tile change, at most LineLength per direction
+    for (uint8_t direction = 0U; direction < LineDirectionsCount; ++direction)
+    {
+        const int rowStep = LineDirections[direction].first;
+        const int colStep = LineDirections[direction].second;
+        for (int offset = 0; offset < Rules::LineLength; ++offset)
+        {
+            int firstRow = rowIdx - offset * rowStep;
+            int firstCol = colIdx - offset * colStep;
+            int lastRow = firstRow + (Rules::LineLength - 1) * rowStep;
+            int lastCol = firstCol + (Rules::LineLength - 1) * colStep;
+            if (firstRow < 1 || lastRow > rows || std::min(firstCol, lastCol) < 1 || std::max(firstCol, lastCol) > cols)
+            {
+                continue;
+            }
+            uint32_t& window = m_windows[direction * directionWindows + (firstRow - 1) * cols + (firstCol - 1)];
+            addWindowPotential(window, -1);
+            window = window - oldBit + newBit;
+            addWindowPotential(window, 1);
+        }
+    }
+}
+
+template<typename GameRules>
+void BasicGameMap<GameRules>::addWindowPotential(uint32_t window, int32_t sign) noexcept
+{
+    if (window == 0U)
+    {
+        return;
+    }
+    // The lowest count belongs to the first content in the window; when it's the only
+    // one the whole window shifts down to that count, anything else leaves higher bits
+    uint8_t content = static_cast<uint8_t>(__builtin_ctz(window) / WindowCountBits);
+    uint32_t balls = window >> (content * WindowCountBits);
+    if (content < Rules::ColoursCount && balls <= Rules::LineLength)
+    {
+        m_linePotentials[content] += sign * LinePotentialWeights[balls];
+    }
 }
 
-TileContent GameMap::getTileContent(uint8_t rowIdx, uint8_t colIdx) const
+template<typename GameRules>
+uint32_t BasicGameMap<GameRules>::getLinePotential(TileContent colour) const noexcept
+{
+    uint8_t content = static_cast<uint8_t>(colour);
+    return content < Rules::ColoursCount ? m_linePotentials[content] : 0U;
+}
+
+template<typename GameRules>
+TileContent BasicGameMap<GameRules>::getTileContent(uint8_t rowIdx, uint8_t colIdx) const
 {
     return m_map[rowIdx][colIdx];
 }
 
-bool GameMap::isTileOccupied(uint8_t rowIdx, uint8_t colIdx) const
+template<typename GameRules>
+bool BasicGameMap<GameRules>::isTileOccupied(uint8_t rowIdx, uint8_t colIdx) const
 {
     TileContent currentTileContent = m_map[rowIdx][colIdx];
     return (currentTileContent != TileContent::None);
 }
 
-std::vector<std::pair<uint8_t, uint8_t>> GameMap::getFreeTiles() const noexcept
+template<typename GameRules>
+std::vector<std::pair<uint8_t, uint8_t>> BasicGameMap<GameRules>::getFreeTiles() const noexcept
 {
     std::vector<std::pair<uint8_t, uint8_t>> freeTiles;
-    for (uint8_t i = 0U; i < m_rows; ++i)
+    for (uint8_t i = 0U; i < PaddedSize; ++i)
     {
-        for (uint8_t j = 0U; j < m_cols; ++j)
+        for (uint8_t j = 0U; j < PaddedSize; ++j)
         {
             if (m_map[i][j] == TileContent::None)
             {
@@ -89,11 +210,12 @@ std::vector<std::pair<uint8_t, uint8_t>> GameMap::getFreeTiles() const noexcept
     return freeTiles;
 }
 
-bool GameMap::isAnyFreeTile() const noexcept
+template<typename GameRules>
+bool BasicGameMap<GameRules>::isAnyFreeTile() const noexcept
 {
-    for (uint8_t i = 0U; i < m_rows; ++i)
+    for (uint8_t i = 0U; i < PaddedSize; ++i)
     {
-        for (uint8_t j = 0U; j < m_cols; ++j)
+        for (uint8_t j = 0U; j < PaddedSize; ++j)
         {
             if (m_map[i][j] == TileContent::None)
             {
@@ -104,7 +226,8 @@ bool GameMap::isAnyFreeTile() const noexcept
     return false;
 }
 
-bool GameMap::findPath(uint8_t fromRow, uint8_t fromCol, uint8_t destRow, uint8_t destCol) const
+template<typename GameRules>
+bool BasicGameMap<GameRules>::findPath(uint8_t fromRow, uint8_t fromCol, uint8_t destRow, uint8_t destCol) const
 {
     std::queue<std::pair<uint8_t, uint8_t>> set;
     if (m_map[fromRow - 1][fromCol] == TileContent::None)
@@ -116,18 +239,18 @@ bool GameMap::findPath(uint8_t fromRow, uint8_t fromCol, uint8_t destRow, uint8_
     if (m_map[fromRow][fromCol + 1] == TileContent::None)
         set.push(std::make_pair(fromRow, fromCol + 1));
 
-    std::vector<std::vector<bool>> visited(m_rows, std::vector<bool>(m_cols));
-    for (uint8_t i = 0U; i < m_rows; ++i)
+    std::array<std::array<bool, PaddedSize>, PaddedSize> visited;
+    for (uint8_t i = 0U; i < PaddedSize; ++i)
     {
-        for (uint8_t j = 0U; j < m_cols; ++j)
+        for (uint8_t j = 0U; j < PaddedSize; ++j)
         {
             if (i == 0U)
                 visited[i][j] = true;
             else if (j == 0U)
                 visited[i][j] = true;
-            else if (i == (m_rows - 1))
+            else if (i == (PaddedSize - 1))
                 visited[i][j] = true;
-            else if (j == (m_cols - 1))
+            else if (j == (PaddedSize - 1))
                 visited[i][j] = true;
             else
                 visited[i][j] = false;
@@ -162,7 +285,62 @@ bool GameMap::findPath(uint8_t fromRow, uint8_t fromCol, uint8_t destRow, uint8_
     return false;
 }
 
-std::vector<std::pair<uint8_t, uint8_t>> GameMap::checkForScore(uint8_t ballXPos, uint8_t ballYPos, TileContent content) const
+template<typename GameRules>
+TilePath BasicGameMap<GameRules>::findShortestPath(uint8_t fromRow, uint8_t fromCol, uint8_t destRow, uint8_t destCol) const
+{
+    static constexpr int8_t Directions[4][2] { {-1, 0}, {0, -1}, {1, 0}, {0, 1} };
+
+    // Breadth-first from the destination, so following the parents from the origin
+    // yields the route in walking order
+    std::array<std::array<std::pair<uint8_t, uint8_t>, PaddedSize>, PaddedSize> parents;
+    for (auto&& row : parents)
+    {
+        row.fill(std::make_pair(0U, 0U));
+    }
+    std::queue<std::pair<uint8_t, uint8_t>> set;
+    set.push(std::make_pair(destRow, destCol));
+    parents[destRow][destCol] = std::make_pair(destRow, destCol);
+
+    bool isFound {false};
+    while (!set.empty() && !isFound)
+    {
+        auto elem = set.front();
+        set.pop();
+        for (auto&& direction : Directions)
+        {
+            uint8_t row = elem.first + direction[0];
+            uint8_t col = elem.second + direction[1];
+            if (row == fromRow && col == fromCol)
+            {
+                parents[row][col] = elem;
+                isFound = true;
+                break;
+            }
+            if (m_map[row][col] == TileContent::None && parents[row][col].first == 0U)
+            {
+                parents[row][col] = elem;
+                set.push(std::make_pair(row, col));
+            }
+        }
+    }
+
+    TilePath path;
+    if (!isFound || m_map[destRow][destCol] != TileContent::None)
+    {
+        return path;
+    }
+    std::pair<uint8_t, uint8_t> tile = std::make_pair(fromRow, fromCol);
+    path.push_back(tile);
+    while (tile != std::make_pair(destRow, destCol))
+    {
+        tile = parents[tile.first][tile.second];
+        path.push_back(tile);
+    }
+    return path;
+}
+
+template<typename GameRules>
+std::vector<std::pair<uint8_t, uint8_t>> BasicGameMap<GameRules>::checkForScore(uint8_t ballXPos, uint8_t ballYPos, TileContent content) const
 {
     std::vector<std::pair<uint8_t, uint8_t>> tilesToBeCleared_leftToRight;
     std::vector<std::pair<uint8_t, uint8_t>> tilesToBeCleared_leftDiagonal;
@@ -310,4 +488,6 @@ std::vector<std::pair<uint8_t, uint8_t>> GameMap::checkForScore(uint8_t ballXPos
     return *(sizeVectorMap.at(sizes.at(0)));
 }
 
+template class BasicGameMap<ClassicRules>;
+
 }
@@ -2,8 +2,13 @@
 #define GAMEMAP_H
 
 #include <cstdint>
+#include <cstddef>
+#include <array>
+#include <utility>
 #include <vector>
 
+#include "rules.h"
+
 namespace Qoolkie
 {
 
@@ -20,15 +25,52 @@ enum class TileContent : uint8_t
     None,
 };
 
-class GameMap
+// Tiles of a ball's route, origin first
+using TilePath = std::vector<std::pair<uint8_t, uint8_t>>;
+
+enum class ColoursUsed : uint8_t
+{
+    Five = 5U,
+    Seven = 7U
+};
+
+// Weight of a line window holding only balls of one colour, by how many balls it
+// holds; every ball more quadruples it
+constexpr uint32_t getLinePotentialWeight(uint8_t balls) noexcept
+{
+    return balls == 0U ? 0U : 1U << (2U * (balls - 1U));
+}
+
+// Weights for 0 to Count - 1 balls, prepended one at a time down to Count 0
+template<uint8_t Count, uint32_t... Weights>
+struct LinePotentialTable : LinePotentialTable<Count - 1, getLinePotentialWeight(Count - 1), Weights...>
+{
+};
+
+template<uint32_t... Weights>
+struct LinePotentialTable<0, Weights...>
+{
+    static constexpr std::array<uint32_t, sizeof...(Weights)> Values {{Weights...}};
+};
+
+template<uint32_t... Weights>
+constexpr std::array<uint32_t, sizeof...(Weights)> LinePotentialTable<0, Weights...>::Values;
+
+// Board of a rules variant; only ClassicRules is instantiated, in gamemap.cpp
+template<typename GameRules>
+class BasicGameMap
 {
 public:
-    GameMap(uint8_t rows, uint8_t cols);
-    GameMap(const GameMap&) = default;
-    GameMap(GameMap&&) = default;
-    GameMap& operator=(const GameMap&) = default;
-    GameMap& operator=(GameMap&&) = default;
-    ~GameMap() = default;
+    using Rules = GameRules;
+
+    static constexpr std::array<uint32_t, Rules::LineLength + 1> LinePotentialWeights {LinePotentialTable<Rules::LineLength + 1>::Values};
+
+    BasicGameMap();
+    BasicGameMap(const BasicGameMap&) = default;
+    BasicGameMap(BasicGameMap&&) = default;
+    BasicGameMap& operator=(const BasicGameMap&) = default;
+    BasicGameMap& operator=(BasicGameMap&&) = default;
+    ~BasicGameMap() = default;
 
     uint8_t getRowsCount() const noexcept;
     uint8_t getColsCount() const noexcept;
@@ -43,18 +85,52 @@ public:
     std::vector<std::pair<uint8_t, uint8_t>> getFreeTiles() const noexcept;
 
     bool findPath(uint8_t from_row, uint8_t from_col, uint8_t dest_row, uint8_t dest_col) const;
+    TilePath findShortestPath(uint8_t fromRow, uint8_t fromCol, uint8_t destRow, uint8_t destCol) const;
     std::vector<std::pair<uint8_t, uint8_t>> checkForScore(uint8_t ballXPos, uint8_t ballYPos, TileContent content) const;
 
+    // setTileContent only notes the tile; this updates the windows through the tiles
+    // changed since, so a move tried and taken back costs no window updates
+    void updateLinePotential() noexcept;
+    // Sum of LinePotentialWeights over every window of LineLength tiles, in any of the
+    // four line directions, holding only free tiles and balls of the given colour, as
+    // of the last updateLinePotential(); a map changed since has to be updated first
+    uint32_t getLinePotential(TileContent colour) const noexcept;
+
 private:
-    using MapType = std::vector<std::vector<TileContent>>;
+    // The board inside a ring of walls, so scans stop at the edge without bounds checks
+    static constexpr uint8_t PaddedSize {Rules::BoardSize + 2};
+    static constexpr uint16_t TilesCount {Rules::BoardSize * Rules::BoardSize};
+    static constexpr uint8_t LineDirectionsCount {4};
+
+    using MapType = std::array<std::array<TileContent, PaddedSize>, PaddedSize>;
+
+    // Every window keeps a 3-bit ball count per tile content, colours and walls alike
+    static constexpr uint8_t WindowCountBits {3};
+
+    static_assert(Rules::LineLength < (1U << WindowCountBits), "A window's ball count has to fit its field");
+    static_assert(static_cast<uint8_t>(TileContent::Wall) * WindowCountBits + WindowCountBits <= 32U, "Window counts have to fit 32 bits");
+
+    // Marks a tile in m_windowTiles as changed since the windows were updated
+    static constexpr uint8_t PendingTileFlag {0x80};
 
-    uint8_t m_rows;
-    uint8_t m_cols;
     MapType m_map;
+    // Indexed by direction, then by the window's first tile
+    std::array<uint32_t, LineDirectionsCount * TilesCount> m_windows;
+    // The content the windows hold for every tile, row by row
+    std::array<uint8_t, TilesCount> m_windowTiles;
+    // Each tile is listed at most once, while its PendingTileFlag is set
+    std::array<uint16_t, TilesCount> m_pendingTiles;
+    uint16_t m_pendingCount;
+    std::array<uint32_t, Rules::ColoursCount> m_linePotentials;
 
     void defaultFillTiles() noexcept;
+    void updateWindows(uint8_t rowIdx, uint8_t colIdx, TileContent oldContent, TileContent newContent) noexcept;
+    void addWindowPotential(uint32_t window, int32_t sign) noexcept;
 };
 
+extern template class BasicGameMap<ClassicRules>;
+using GameMap = BasicGameMap<ClassicRules>;
+
 }
 
 #endif
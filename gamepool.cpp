@@ -0,0 +1,355 @@
+#include "gamepool.h"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+namespace Qoolkie
+{
+
+constexpr uint8_t GamePool::BoardRows;
+constexpr uint8_t GamePool::BoardCols;
+constexpr uint8_t GamePool::CellsPerBoard;
+constexpr uint8_t GamePool::CellStride;
+constexpr uint8_t GamePool::GameOverFlag;
+
+namespace
+{
+
+// Same spawn palette as Game, so a pool session and a Game fed the same RNG
+// stream produce the same board.
+constexpr TileContent ContentsPot[] { TileContent::Black, TileContent::Blue, TileContent::Green, TileContent::Pink,
+                                      TileContent::Red, TileContent::Yellow, TileContent::Purple };
+
+static_assert(sizeof(ContentsPot) / sizeof(ContentsPot[0]) == GamePool::Rules::ColoursCount, "Every colour of the rules needs a palette slot");
+
+}
+
+GamePool::GamePool(uint32_t capacity) : m_capacity(capacity),
+                                        m_cells(static_cast<size_t>(capacity) * CellStride),
+                                        m_scores(capacity),
+                                        m_gains(capacity),
+                                        m_rngStates(capacity),
+                                        m_colours(capacity),
+                                        m_flags(capacity),
+                                        m_generations(capacity),
+                                        m_activeMask((capacity + 63U) / 64U)
+{
+    m_freeSlots.reserve(capacity);
+    for (uint32_t i = capacity; i > 0U; --i)
+    {
+        m_freeSlots.push_back(i - 1U);
+    }
+}
+
+uint32_t GamePool::getCapacity() const noexcept
+{
+    return m_capacity;
+}
+
+uint32_t GamePool::getActiveCount() const noexcept
+{
+    return m_activeCount;
+}
+
+size_t GamePool::getBytesPerSession() noexcept
+{
+    // cells, score, gain, RNG state, colours, flags, generation and free list entry;
+    // the active bitmask adds one more bit per slot
+    return CellStride + sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint64_t) + sizeof(uint8_t) * 2
+           + sizeof(uint32_t) * 2;
+}
+
+SessionHandle GamePool::acquire(ColoursUsed colours, uint64_t seed)
+{
+    if (m_freeSlots.empty())
+    {
+        throw std::runtime_error("Game pool is full");
+    }
+    uint32_t index = m_freeSlots.back();
+    m_freeSlots.pop_back();
+
+    m_activeMask[index / 64U] |= (1ULL << (index % 64U));
+    ++m_activeCount;
+
+    clearCells(index);
+    m_scores[index] = 0U;
+    m_gains[index] = static_cast<uint8_t>(colours);
+    m_colours[index] = static_cast<uint8_t>(colours);
+    m_flags[index] = 0U;
+
+    Rng rng {seed};
+    loadScratch(index);
+    generateQoolkies(index, rng);
+    storeScratch(index);
+    m_rngStates[index] = rng.getState();
+
+    return SessionHandle {index, m_generations[index]};
+}
+
+void GamePool::release(SessionHandle handle)
+{
+    uint32_t index = checkedIndex(handle);
+    m_activeMask[index / 64U] &= ~(1ULL << (index % 64U));
+    --m_activeCount;
+    ++m_generations[index];
+    m_freeSlots.push_back(index);
+}
+
+bool GamePool::isValid(SessionHandle handle) const noexcept
+{
+    if (handle.index >= m_capacity)
+    {
+        return false;
+    }
+    bool isActive = (m_activeMask[handle.index / 64U] >> (handle.index % 64U)) & 1U;
+    return isActive && m_generations[handle.index] == handle.generation;
+}
+
+uint32_t GamePool::checkedIndex(SessionHandle handle) const
+{
+    if (!isValid(handle))
+    {
+        throw std::runtime_error("Stale or invalid game session handle");
+    }
+    return handle.index;
+}
+
+TileContent GamePool::getCell(uint32_t index, uint8_t cellIdx) const noexcept
+{
+    uint8_t packed = m_cells[static_cast<size_t>(index) * CellStride + cellIdx / 2];
+    return static_cast<TileContent>((cellIdx & 1U) ? (packed >> 4) : (packed & 0x0F));
+}
+
+void GamePool::setCell(uint32_t index, uint8_t cellIdx, TileContent content) noexcept
+{
+    uint8_t& packed = m_cells[static_cast<size_t>(index) * CellStride + cellIdx / 2];
+    uint8_t value = static_cast<uint8_t>(content);
+    if (cellIdx & 1U)
+    {
+        packed = static_cast<uint8_t>((packed & 0x0F) | (value << 4));
+    }
+    else
+    {
+        packed = static_cast<uint8_t>((packed & 0xF0) | value);
+    }
+}
+
+void GamePool::clearCells(uint32_t index) noexcept
+{
+    uint8_t none = static_cast<uint8_t>(TileContent::None);
+    uint8_t* cells = m_cells.data() + static_cast<size_t>(index) * CellStride;
+    std::fill(cells, cells + CellStride, static_cast<uint8_t>(none | (none << 4)));
+}
+
+TileContent GamePool::getTileContent(SessionHandle handle, uint8_t rowIdx, uint8_t colIdx) const
+{
+    return getCell(checkedIndex(handle), rowIdx * BoardCols + colIdx);
+}
+
+void GamePool::setTileContent(SessionHandle handle, uint8_t rowIdx, uint8_t colIdx, TileContent content)
+{
+    setCell(checkedIndex(handle), rowIdx * BoardCols + colIdx, content);
+}
+
+uint32_t GamePool::getScore(SessionHandle handle) const
+{
+    return m_scores[checkedIndex(handle)];
+}
+
+ColoursUsed GamePool::getColours(SessionHandle handle) const
+{
+    return static_cast<ColoursUsed>(m_colours[checkedIndex(handle)]);
+}
+
+uint64_t GamePool::getRngState(SessionHandle handle) const
+{
+    return m_rngStates[checkedIndex(handle)];
+}
+
+void GamePool::reseed(SessionHandle handle, uint64_t seed)
+{
+    m_rngStates[checkedIndex(handle)] = Rng {seed}.getState();
+}
+
+bool GamePool::isGameOver(SessionHandle handle) const
+{
+    return (m_flags[checkedIndex(handle)] & GameOverFlag) != 0U;
+}
+
+void GamePool::copySession(SessionHandle from, SessionHandle to)
+{
+    copySession(*this, from, to);
+}
+
+void GamePool::copySession(const GamePool& source, SessionHandle from, SessionHandle to)
+{
+    uint32_t src = source.checkedIndex(from);
+    uint32_t dst = checkedIndex(to);
+    std::copy_n(source.m_cells.begin() + static_cast<size_t>(src) * CellStride, CellStride,
+                m_cells.begin() + static_cast<size_t>(dst) * CellStride);
+    m_scores[dst] = source.m_scores[src];
+    m_gains[dst] = source.m_gains[src];
+    m_rngStates[dst] = source.m_rngStates[src];
+    m_colours[dst] = source.m_colours[src];
+    m_flags[dst] = source.m_flags[src];
+}
+
+uint64_t GamePool::hashSession(SessionHandle handle) const
+{
+    uint32_t index = checkedIndex(handle);
+    const uint8_t* cells = m_cells.data() + static_cast<size_t>(index) * CellStride;
+
+    // FNV-1a over the packed cells, then the RNG position and score folded in
+    uint64_t hash {0xCBF29CE484222325ULL};
+    for (uint8_t i = 0U; i < (CellsPerBoard + 1) / 2; ++i)
+    {
+        hash = (hash ^ cells[i]) * 0x100000001B3ULL;
+    }
+    hash ^= m_rngStates[index] + 0x9E3779B97F4A7C15ULL + (hash << 6) + (hash >> 2);
+    hash ^= m_scores[index] + 0x9E3779B97F4A7C15ULL + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+void GamePool::loadMap(SessionHandle handle, GameMap& map) const
+{
+    uint32_t index = checkedIndex(handle);
+    for (uint8_t i = 0U; i < BoardRows; ++i)
+    {
+        for (uint8_t j = 0U; j < BoardCols; ++j)
+        {
+            map.setTileContent(i + 1, j + 1, getCell(index, i * BoardCols + j));
+        }
+    }
+}
+
+void GamePool::storeMap(SessionHandle handle, const GameMap& map)
+{
+    uint32_t index = checkedIndex(handle);
+    for (uint8_t i = 0U; i < BoardRows; ++i)
+    {
+        for (uint8_t j = 0U; j < BoardCols; ++j)
+        {
+            setCell(index, i * BoardCols + j, map.getTileContent(i + 1, j + 1));
+        }
+    }
+}
+
+void GamePool::loadScratch(uint32_t index)
+{
+    loadMap(SessionHandle {index, m_generations[index]}, m_scratch);
+}
+
+void GamePool::storeScratch(uint32_t index)
+{
+    storeMap(SessionHandle {index, m_generations[index]}, m_scratch);
+}
+
+MoveResult GamePool::move(SessionHandle handle, uint8_t fromRow, uint8_t fromCol, uint8_t destRow, uint8_t destCol)
+{
+    uint32_t index = checkedIndex(handle);
+    MoveResult result {false, (m_flags[index] & GameOverFlag) != 0U, 0U, PositionState::Live};
+    if (result.isGameOver || fromRow >= BoardRows || fromCol >= BoardCols || destRow >= BoardRows || destCol >= BoardCols)
+    {
+        return result;
+    }
+
+    loadScratch(index);
+    uint8_t x = fromRow + 1;
+    uint8_t y = fromCol + 1;
+    uint8_t destX = destRow + 1;
+    uint8_t destY = destCol + 1;
+    if (!m_scratch.isTileOccupied(x, y) || m_scratch.isTileOccupied(destX, destY) || !m_scratch.findPath(x, y, destX, destY))
+    {
+        return result;
+    }
+    result.isLegal = true;
+
+    TileContent content = m_scratch.getTileContent(x, y);
+    m_scratch.setTileContent(x, y, TileContent::None);
+    m_scratch.setTileContent(destX, destY, content);
+
+    auto ret = m_scratch.checkForScore(destX, destY, content);
+    if (Rules::isScoringLine(ret.size()))
+    {
+        result.gain = doScore(index, ret);
+    }
+    else
+    {
+        Rng rng;
+        rng.setState(m_rngStates[index]);
+        generateQoolkies(index, rng);
+        m_rngStates[index] = rng.getState();
+        if (!m_scratch.isAnyFreeTile())
+        {
+            m_flags[index] |= GameOverFlag;
+            result.isGameOver = true;
+        }
+    }
+    // Decided positions end here too, just like in Game
+    if (!result.isGameOver)
+    {
+        PositionVerdict verdict = classifyPosition(m_scratch);
+        if (verdict.state != PositionState::Live)
+        {
+            m_flags[index] |= GameOverFlag;
+            result.isGameOver = true;
+            result.position = verdict.state;
+        }
+    }
+
+    storeScratch(index);
+    return result;
+}
+
+void GamePool::generateQoolkies(uint32_t index, Rng& rng)
+{
+    if (!m_scratch.isAnyFreeTile())
+    {
+        return;
+    }
+    std::vector<std::pair<uint8_t, uint8_t>> freeTiles = m_scratch.getFreeTiles();
+    std::array<std::pair<std::pair<uint8_t, uint8_t>, TileContent>, Rules::SpawnsPerTurn> generatedTiles;
+    uint8_t generatedNb {0U};
+
+    for (uint8_t i = 0U; i < Rules::SpawnsPerTurn; ++i)
+    {
+        if (!m_scratch.isAnyFreeTile())
+        {
+            break;
+        }
+        uint8_t tileIdx = rng.nextBelow(static_cast<uint32_t>(freeTiles.size()));
+        uint8_t contentIdx = rng.nextBelow(m_colours[index]);
+
+        std::pair<uint8_t, uint8_t> tile = freeTiles.at(tileIdx);
+        freeTiles.erase(freeTiles.begin() + tileIdx);
+
+        TileContent content = ContentsPot[contentIdx];
+        generatedTiles[generatedNb++] = std::make_pair(tile, content);
+        m_scratch.setTileContent(tile.first, tile.second, content);
+    }
+
+    // Game keeps the spawned tiles in a std::map, so lines are checked in tile order
+    std::sort(generatedTiles.begin(), generatedTiles.begin() + generatedNb);
+    for (uint8_t i = 0U; i < generatedNb; ++i)
+    {
+        auto ret = m_scratch.checkForScore(generatedTiles[i].first.first, generatedTiles[i].first.second, generatedTiles[i].second);
+        if (Rules::isScoringLine(ret.size()))
+        {
+            doScore(index, ret);
+        }
+    }
+}
+
+uint16_t GamePool::doScore(uint32_t index, const std::vector<std::pair<uint8_t, uint8_t>>& tiles)
+{
+    for (auto&& tile : tiles)
+    {
+        m_scratch.setTileContent(tile.first, tile.second, TileContent::None);
+    }
+    uint16_t gain = Rules::calculateGain(m_gains[index], tiles.size());
+    m_scores[index] += gain;
+    return gain;
+}
+
+}
@@ -0,0 +1,120 @@
+#ifndef GAMEPOOL_H
+#define GAMEPOOL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "deadposition.h"
+#include "gamemap.h"
+#include "rng.h"
+
+namespace Qoolkie
+{
+
+struct SessionHandle
+{
+    uint32_t index;
+    uint32_t generation;
+};
+
+struct MoveResult
+{
+    bool isLegal;
+    bool isGameOver;
+    uint16_t gain;
+    // Why a game ended with free tiles left, Live otherwise
+    PositionState position;
+};
+
+// Stores many boards in structure-of-arrays form: one packed cell plane per slot
+// (4 bits per tile) plus parallel score, gain, RNG and state arrays. All storage
+// is allocated up front, slots are recycled through a free list and handles carry
+// a generation counter so a released session can't be touched by a stale handle.
+// A pool is meant to be stepped from a single thread.
+class GamePool
+{
+public:
+    using Rules = GameMap::Rules;
+
+    static constexpr uint8_t BoardRows {Rules::BoardSize};
+    static constexpr uint8_t BoardCols {Rules::BoardSize};
+    static constexpr uint8_t CellsPerBoard {BoardRows * BoardCols};
+    // Two cells per byte, padded to whole 16-byte blocks
+    static constexpr uint8_t CellStride {((CellsPerBoard + 1) / 2 + 15) / 16 * 16};
+
+    static_assert(CellStride * 2 >= CellsPerBoard, "A board's packed cells have to fit its stride");
+
+    explicit GamePool(uint32_t capacity);
+
+    uint32_t getCapacity() const noexcept;
+    uint32_t getActiveCount() const noexcept;
+    static size_t getBytesPerSession() noexcept;
+
+    SessionHandle acquire(ColoursUsed colours, uint64_t seed);
+    void release(SessionHandle handle);
+    bool isValid(SessionHandle handle) const noexcept;
+
+    TileContent getTileContent(SessionHandle handle, uint8_t rowIdx, uint8_t colIdx) const;
+    void setTileContent(SessionHandle handle, uint8_t rowIdx, uint8_t colIdx, TileContent content);
+    uint32_t getScore(SessionHandle handle) const;
+    ColoursUsed getColours(SessionHandle handle) const;
+    uint64_t getRngState(SessionHandle handle) const;
+    void reseed(SessionHandle handle, uint64_t seed);
+    bool isGameOver(SessionHandle handle) const;
+
+    MoveResult move(SessionHandle handle, uint8_t fromRow, uint8_t fromCol, uint8_t destRow, uint8_t destCol);
+    void copySession(SessionHandle from, SessionHandle to);
+    void copySession(const GamePool& source, SessionHandle from, SessionHandle to);
+    uint64_t hashSession(SessionHandle handle) const;
+
+    void loadMap(SessionHandle handle, GameMap& map) const;
+    void storeMap(SessionHandle handle, const GameMap& map);
+
+    template<typename Function>
+    void forEachActive(Function function) const
+    {
+        for (uint32_t word = 0U; word < m_activeMask.size(); ++word)
+        {
+            uint64_t bits = m_activeMask[word];
+            while (bits != 0U)
+            {
+                uint32_t index = word * 64U + static_cast<uint32_t>(__builtin_ctzll(bits));
+                bits &= bits - 1U;
+                function(SessionHandle {index, m_generations[index]});
+            }
+        }
+    }
+
+private:
+    static constexpr uint8_t GameOverFlag {0x01};
+
+    uint32_t checkedIndex(SessionHandle handle) const;
+    TileContent getCell(uint32_t index, uint8_t cellIdx) const noexcept;
+    void setCell(uint32_t index, uint8_t cellIdx, TileContent content) noexcept;
+    void clearCells(uint32_t index) noexcept;
+
+    void loadScratch(uint32_t index);
+    void storeScratch(uint32_t index);
+    void generateQoolkies(uint32_t index, Rng& rng);
+    uint16_t doScore(uint32_t index, const std::vector<std::pair<uint8_t, uint8_t>>& tiles);
+
+    uint32_t m_capacity;
+    uint32_t m_activeCount {0U};
+
+    std::vector<uint8_t> m_cells;
+    std::vector<uint32_t> m_scores;
+    std::vector<uint16_t> m_gains;
+    std::vector<uint64_t> m_rngStates;
+    std::vector<uint8_t> m_colours;
+    std::vector<uint8_t> m_flags;
+    std::vector<uint32_t> m_generations;
+    std::vector<uint64_t> m_activeMask;
+    std::vector<uint32_t> m_freeSlots;
+
+    GameMap m_scratch;
+};
+
+}
+
+#endif
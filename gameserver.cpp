@@ -0,0 +1,134 @@
+#include "gameserver.h"
+
+namespace Qoolkie
+{
+
+ClientSession::ClientSession(QLocalSocket* socket, QObject* parent) : QObject(parent), m_socket(socket)
+{
+    m_socket->setParent(this);
+    connect(m_socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    connect(m_socket, SIGNAL(disconnected()), this, SLOT(deleteLater()));
+
+    connect(&m_game, SIGNAL(qoolkieGenerated(uint8_t,uint8_t,Qoolkie::TileContent)), this, SLOT(onQoolkieGenerated(uint8_t,uint8_t,Qoolkie::TileContent)));
+    connect(&m_game, SIGNAL(tileCleared(uint8_t,uint8_t)), this, SLOT(onTileCleared(uint8_t,uint8_t)));
+    connect(&m_game, SIGNAL(scoreChanged(uint32_t)), this, SLOT(onScoreChanged(uint32_t)));
+    connect(&m_game, SIGNAL(gameOver()), this, SLOT(onGameOver()));
+}
+
+void ClientSession::onReadyRead()
+{
+    m_buffer.append(m_socket->readAll());
+    QByteArray payload;
+    while (Protocol::takeFrame(m_buffer, payload))
+    {
+        handlePayload(payload);
+    }
+}
+
+void ClientSession::handlePayload(const QByteArray& payload)
+{
+    if (payload.isEmpty())
+    {
+        return;
+    }
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(payload.constData());
+    auto type = static_cast<Protocol::MessageType>(data[0]);
+
+    if (type == Protocol::MessageType::NewGame && payload.size() == 2)
+    {
+        auto colours = data[1] == static_cast<uint8_t>(ColoursUsed::Seven) ? ColoursUsed::Seven : ColoursUsed::Five;
+        m_isGameOver = false;
+        m_diff.flags |= Protocol::BoardResetFlag;
+        m_diff.score = 0U;
+        m_game.start(colours);
+    }
+    else if (type == Protocol::MessageType::Move && payload.size() == 5)
+    {
+        if (m_isGameOver || !m_game.moveBall(data[1], data[2], data[3], data[4]))
+        {
+            m_diff.flags |= Protocol::MoveRejectedFlag;
+        }
+    }
+    else
+    {
+        m_socket->abort();
+        return;
+    }
+    flushDiff();
+}
+
+void ClientSession::onQoolkieGenerated(uint8_t x, uint8_t y, TileContent content)
+{
+    m_diff.tiles.push_back(std::make_pair(static_cast<uint8_t>(x * Protocol::BoardCols + y), content));
+}
+
+void ClientSession::onTileCleared(uint8_t x, uint8_t y)
+{
+    m_diff.tiles.push_back(std::make_pair(static_cast<uint8_t>(x * Protocol::BoardCols + y), TileContent::None));
+}
+
+void ClientSession::onScoreChanged(uint32_t score)
+{
+    m_diff.score = score;
+}
+
+void ClientSession::onGameOver()
+{
+    m_isGameOver = true;
+}
+
+void ClientSession::flushDiff()
+{
+    if (m_isGameOver)
+    {
+        m_diff.flags |= Protocol::GameOverFlag;
+    }
+    m_socket->write(Protocol::encodeTurnDiff(m_diff));
+    m_diff.tiles.clear();
+    m_diff.flags = 0U;
+}
+
+void SessionShard::addConnection(quintptr socketDescriptor)
+{
+    QLocalSocket* socket = new QLocalSocket();
+    if (!socket->setSocketDescriptor(socketDescriptor))
+    {
+        delete socket;
+        return;
+    }
+    new ClientSession(socket, this);
+}
+
+GameServer::GameServer(int shardsCount, QObject* parent) : QLocalServer(parent)
+{
+    qRegisterMetaType<quintptr>("quintptr");
+    for (int i = 0; i < shardsCount; ++i)
+    {
+        QThread* thread = new QThread(this);
+        SessionShard* shard = new SessionShard();
+        shard->moveToThread(thread);
+        connect(thread, SIGNAL(finished()), shard, SLOT(deleteLater()));
+        thread->start();
+
+        m_threads.push_back(thread);
+        m_shards.push_back(shard);
+    }
+}
+
+GameServer::~GameServer() noexcept
+{
+    for (auto&& thread : m_threads)
+    {
+        thread->quit();
+        thread->wait();
+    }
+}
+
+void GameServer::incomingConnection(quintptr socketDescriptor)
+{
+    SessionShard* shard = m_shards[m_nextShard];
+    m_nextShard = (m_nextShard + 1) % m_shards.size();
+    QMetaObject::invokeMethod(shard, "addConnection", Qt::QueuedConnection, Q_ARG(quintptr, socketDescriptor));
+}
+
+}
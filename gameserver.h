@@ -0,0 +1,74 @@
+#ifndef GAMESERVER_H
+#define GAMESERVER_H
+
+#include <cstdint>
+#include <vector>
+#include <QObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QThread>
+
+#include "game.h"
+#include "protocol.h"
+
+namespace Qoolkie
+{
+
+// One connected screen: a socket and the Game it drives. Lives in its shard's thread,
+// collects the Game signals emitted while a command runs and answers with one TurnDiff.
+class ClientSession : public QObject
+{
+    Q_OBJECT
+
+public:
+    ClientSession(QLocalSocket* socket, QObject* parent = nullptr);
+
+public slots:
+    void onReadyRead();
+    void onQoolkieGenerated(uint8_t x, uint8_t y, Qoolkie::TileContent content);
+    void onTileCleared(uint8_t x, uint8_t y);
+    void onScoreChanged(uint32_t score);
+    void onGameOver();
+
+private:
+    void handlePayload(const QByteArray& payload);
+    void flushDiff();
+
+    QLocalSocket* m_socket;
+    Game m_game;
+    QByteArray m_buffer;
+    Protocol::TurnDiff m_diff;
+    bool m_isGameOver {false};
+};
+
+// Owns the sessions of one event loop thread.
+class SessionShard : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void addConnection(quintptr socketDescriptor);
+};
+
+// Accepts connections on a local socket and deals them round-robin to one
+// event loop thread per shard, so sessions on different shards never contend.
+class GameServer : public QLocalServer
+{
+    Q_OBJECT
+
+public:
+    explicit GameServer(int shardsCount, QObject* parent = nullptr);
+    ~GameServer() noexcept;
+
+protected:
+    void incomingConnection(quintptr socketDescriptor) override;
+
+private:
+    std::vector<QThread*> m_threads;
+    std::vector<SessionShard*> m_shards;
+    size_t m_nextShard {0U};
+};
+
+}
+
+#endif
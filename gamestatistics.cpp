@@ -0,0 +1,281 @@
+#include "gamestatistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <QDataStream>
+#include <QTextStream>
+
+namespace Qoolkie
+{
+
+constexpr uint16_t QuantileSketch::SubBuckets;
+constexpr uint16_t QuantileSketch::BucketsCount;
+constexpr uint8_t StatisticsSnapshot::BoardCells;
+constexpr uint8_t StatisticsSnapshot::LineTiers;
+
+namespace
+{
+
+constexpr uint32_t SnapshotMagic {0x41545351}; // "QSTA"
+constexpr uint16_t SnapshotVersion {1U};
+constexpr uint8_t SubBucketBits {5U};
+constexpr uint8_t BoardSize {GameMap::Rules::BoardSize};
+constexpr double ReportedQuantiles[] { 0.1, 0.25, 0.5, 0.75, 0.9, 0.99 };
+
+std::atomic<uint64_t> nextCollectorId {1U};
+
+// Only the owning thread writes a shard, so a relaxed load and store is enough and
+// avoids the locked read-modify-write of fetch_add
+inline void bump(std::atomic<uint64_t>& counter, uint64_t delta = 1U) noexcept
+{
+    counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+void writeSketch(QDataStream& stream, const QuantileSketch& sketch)
+{
+    uint16_t used {0U};
+    for (uint16_t i = 0U; i < QuantileSketch::BucketsCount; ++i)
+    {
+        used += sketch.getBucket(i) != 0U ? 1U : 0U;
+    }
+    stream << static_cast<quint16>(used);
+    for (uint16_t i = 0U; i < QuantileSketch::BucketsCount; ++i)
+    {
+        if (sketch.getBucket(i) != 0U)
+        {
+            stream << static_cast<quint16>(i) << static_cast<quint64>(sketch.getBucket(i));
+        }
+    }
+}
+
+}
+
+uint16_t QuantileSketch::bucketOf(uint32_t value) noexcept
+{
+    if (value < SubBuckets)
+    {
+        return static_cast<uint16_t>(value);
+    }
+    uint32_t exponent = 31U - static_cast<uint32_t>(__builtin_clz(value));
+    uint32_t mantissa = (value >> (exponent - SubBucketBits)) & (SubBuckets - 1U);
+    return static_cast<uint16_t>(SubBuckets + (exponent - SubBucketBits) * SubBuckets + mantissa);
+}
+
+uint32_t QuantileSketch::lowerBoundOf(uint16_t bucket) noexcept
+{
+    if (bucket < SubBuckets)
+    {
+        return bucket;
+    }
+    uint32_t exponent = (bucket - SubBuckets) / SubBuckets + SubBucketBits;
+    uint32_t mantissa = (bucket - SubBuckets) % SubBuckets;
+    return (SubBuckets + mantissa) << (exponent - SubBucketBits);
+}
+
+void QuantileSketch::add(uint32_t value, uint64_t count) noexcept
+{
+    m_buckets[bucketOf(value)] += count;
+    m_count += count;
+}
+
+void QuantileSketch::merge(const QuantileSketch& other) noexcept
+{
+    for (uint16_t i = 0U; i < BucketsCount; ++i)
+    {
+        m_buckets[i] += other.m_buckets[i];
+    }
+    m_count += other.m_count;
+}
+
+uint64_t QuantileSketch::getCount() const noexcept
+{
+    return m_count;
+}
+
+uint64_t QuantileSketch::getBucket(uint16_t bucket) const noexcept
+{
+    return m_buckets[bucket];
+}
+
+uint32_t QuantileSketch::getQuantile(double q) const noexcept
+{
+    if (m_count == 0U)
+    {
+        return 0U;
+    }
+    uint64_t rank = std::max<uint64_t>(1U, static_cast<uint64_t>(std::ceil(q * m_count)));
+    uint64_t seen {0U};
+    for (uint16_t i = 0U; i < BucketsCount; ++i)
+    {
+        seen += m_buckets[i];
+        if (seen >= rank)
+        {
+            uint32_t lower = lowerBoundOf(i);
+            uint32_t width = (i + 1U < BucketsCount ? lowerBoundOf(i + 1U) : UINT32_MAX) - lower;
+            return lower + width / 2U;
+        }
+    }
+    return lowerBoundOf(BucketsCount - 1U);
+}
+
+void StatisticsSnapshot::writeBinary(QIODevice& device) const
+{
+    QDataStream stream(&device);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream << static_cast<quint32>(SnapshotMagic) << static_cast<quint16>(SnapshotVersion);
+    stream << static_cast<quint64>(games) << static_cast<quint64>(turns) << static_cast<quint64>(spawnedBalls);
+    for (uint64_t count : lines)
+    {
+        stream << static_cast<quint64>(count);
+    }
+    for (uint8_t i = 0U; i < BoardCells; ++i)
+    {
+        stream << static_cast<quint64>(occupancy[i]) << static_cast<quint64>(clears[i]);
+    }
+    writeSketch(stream, scores);
+    writeSketch(stream, gameLengths);
+}
+
+void StatisticsSnapshot::writeCsv(QIODevice& device) const
+{
+    QTextStream out(&device);
+    out << "metric,key,value\n";
+    out << "games,," << games << '\n';
+    out << "turns,," << turns << '\n';
+    out << "spawned_balls,," << spawnedBalls << '\n';
+    for (size_t i = 0U; i < lines.size(); ++i)
+    {
+        out << "line_length," << GameMap::Rules::LineLength + i << (i + 1U == lines.size() ? "+" : "") << ',' << lines[i] << '\n';
+    }
+    for (double q : ReportedQuantiles)
+    {
+        out << "score_quantile," << q << ',' << scores.getQuantile(q) << '\n';
+    }
+    for (double q : ReportedQuantiles)
+    {
+        out << "game_length_quantile," << q << ',' << gameLengths.getQuantile(q) << '\n';
+    }
+    for (uint8_t i = 0U; i < BoardCells; ++i)
+    {
+        out << "occupancy,r" << i / BoardSize << 'c' << i % BoardSize << ',' << occupancy[i] << '\n';
+    }
+    for (uint8_t i = 0U; i < BoardCells; ++i)
+    {
+        out << "clears,r" << i / BoardSize << 'c' << i % BoardSize << ',' << clears[i] << '\n';
+    }
+}
+
+GameStatistics::GameStatistics() : m_id(nextCollectorId++)
+{
+}
+
+GameStatistics::Shard& GameStatistics::getLocalShard()
+{
+    // Collectors get unique ids, so a new collector at a reused address never picks up
+    // a stale shard. The last one used is checked first as threads rarely switch.
+    thread_local uint64_t cachedId {0U};
+    thread_local Shard* cachedShard {nullptr};
+    thread_local std::vector<std::pair<uint64_t, Shard*>> knownShards;
+    if (cachedId == m_id)
+    {
+        return *cachedShard;
+    }
+
+    auto known = std::find_if(knownShards.begin(), knownShards.end(),
+                              [this](const std::pair<uint64_t, Shard*>& entry) { return entry.first == m_id; });
+    if (known != knownShards.end())
+    {
+        cachedShard = known->second;
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(m_shardsMutex);
+        m_shards.emplace_back(new Shard());
+        cachedShard = m_shards.back().get();
+        knownShards.emplace_back(m_id, cachedShard);
+    }
+    cachedId = m_id;
+    return *cachedShard;
+}
+
+void GameStatistics::recordTurn(const GameMap& map) noexcept
+{
+    Shard& shard = getLocalShard();
+    bump(shard.turns);
+    uint8_t rows = map.getRowsCount();
+    uint8_t cols = map.getColsCount();
+    for (uint8_t i = 0U; i < rows && i < BoardSize; ++i)
+    {
+        for (uint8_t j = 0U; j < cols && j < BoardSize; ++j)
+        {
+            if (map.isTileOccupied(i + 1, j + 1))
+            {
+                bump(shard.occupancy[i * BoardSize + j]);
+            }
+        }
+    }
+}
+
+void GameStatistics::recordSpawn(uint8_t balls) noexcept
+{
+    bump(getLocalShard().spawnedBalls, balls);
+}
+
+void GameStatistics::recordLine(const std::vector<std::pair<uint8_t, uint8_t>>& tiles) noexcept
+{
+    Shard& shard = getLocalShard();
+    size_t extraBalls = tiles.size() - std::min<size_t>(tiles.size(), GameMap::Rules::LineLength);
+    bump(shard.lines[std::min<size_t>(extraBalls, StatisticsSnapshot::LineTiers - 1U)]);
+    for (auto&& tile : tiles)
+    {
+        if (tile.first >= 1U && tile.first <= BoardSize && tile.second >= 1U && tile.second <= BoardSize)
+        {
+            bump(shard.clears[(tile.first - 1) * BoardSize + tile.second - 1]);
+        }
+    }
+}
+
+void GameStatistics::recordGameOver(uint32_t score, uint32_t turns) noexcept
+{
+    Shard& shard = getLocalShard();
+    bump(shard.games);
+    bump(shard.scores.buckets[QuantileSketch::bucketOf(score)]);
+    bump(shard.gameLengths.buckets[QuantileSketch::bucketOf(turns)]);
+}
+
+StatisticsSnapshot GameStatistics::snapshot() const
+{
+    StatisticsSnapshot snapshot;
+    std::lock_guard<std::mutex> lock(m_shardsMutex);
+    for (auto&& shard : m_shards)
+    {
+        snapshot.games += shard->games.load(std::memory_order_relaxed);
+        snapshot.turns += shard->turns.load(std::memory_order_relaxed);
+        snapshot.spawnedBalls += shard->spawnedBalls.load(std::memory_order_relaxed);
+        for (size_t i = 0U; i < snapshot.lines.size(); ++i)
+        {
+            snapshot.lines[i] += shard->lines[i].load(std::memory_order_relaxed);
+        }
+        for (uint8_t i = 0U; i < StatisticsSnapshot::BoardCells; ++i)
+        {
+            snapshot.occupancy[i] += shard->occupancy[i].load(std::memory_order_relaxed);
+            snapshot.clears[i] += shard->clears[i].load(std::memory_order_relaxed);
+        }
+        for (uint16_t i = 0U; i < QuantileSketch::BucketsCount; ++i)
+        {
+            uint64_t scores = shard->scores.buckets[i].load(std::memory_order_relaxed);
+            uint64_t lengths = shard->gameLengths.buckets[i].load(std::memory_order_relaxed);
+            if (scores != 0U)
+            {
+                snapshot.scores.add(QuantileSketch::lowerBoundOf(i), scores);
+            }
+            if (lengths != 0U)
+            {
+                snapshot.gameLengths.add(QuantileSketch::lowerBoundOf(i), lengths);
+            }
+        }
+    }
+    return snapshot;
+}
+
+}
@@ -0,0 +1,106 @@
+#ifndef GAMESTATISTICS_H
+#define GAMESTATISTICS_H
+
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <QIODevice>
+
+#include "gamemap.h"
+
+namespace Qoolkie
+{
+
+// Log-bucketed histogram: values below SubBuckets are exact, larger ones keep their top
+// log2(SubBuckets) bits, so quantiles are within ~3% and two sketches merge by adding buckets.
+class QuantileSketch
+{
+public:
+    static constexpr uint16_t SubBuckets {32};
+    static constexpr uint16_t BucketsCount {SubBuckets + (32 - 5) * SubBuckets};
+
+    static uint16_t bucketOf(uint32_t value) noexcept;
+    static uint32_t lowerBoundOf(uint16_t bucket) noexcept;
+
+    void add(uint32_t value, uint64_t count = 1U) noexcept;
+    void merge(const QuantileSketch& other) noexcept;
+    uint64_t getCount() const noexcept;
+    uint64_t getBucket(uint16_t bucket) const noexcept;
+    uint32_t getQuantile(double q) const noexcept;
+
+private:
+    std::array<uint64_t, BucketsCount> m_buckets {};
+    uint64_t m_count {0U};
+};
+
+struct StatisticsSnapshot
+{
+    static constexpr uint8_t BoardCells {GameMap::Rules::BoardSize * GameMap::Rules::BoardSize};
+    // Scoring lines by how many balls they have beyond LineLength, tiered like the gain
+    // table, so the last tier counts every longer line as well
+    static constexpr uint8_t LineTiers {GameMap::Rules::Gains::Count};
+
+    uint64_t games {0U};
+    uint64_t turns {0U};
+    uint64_t spawnedBalls {0U};
+    std::array<uint64_t, LineTiers> lines {};
+    std::array<uint64_t, BoardCells> occupancy {};
+    std::array<uint64_t, BoardCells> clears {};
+    QuantileSketch scores;
+    QuantileSketch gameLengths;
+
+    void writeBinary(QIODevice& device) const;
+    void writeCsv(QIODevice& device) const;
+};
+
+// Collects turn statistics from any number of threads. Every thread writes only to its
+// own shard with relaxed atomic stores, so recording never takes a lock or contends on
+// a cache line; snapshot() sums the shards. Memory is fixed per thread whatever the
+// number of games.
+class GameStatistics
+{
+public:
+    GameStatistics();
+
+    void recordTurn(const GameMap& map) noexcept;
+    void recordSpawn(uint8_t balls) noexcept;
+    void recordLine(const std::vector<std::pair<uint8_t, uint8_t>>& tiles) noexcept;
+    void recordGameOver(uint32_t score, uint32_t turns) noexcept;
+
+    StatisticsSnapshot snapshot() const;
+
+private:
+    struct AtomicSketch
+    {
+        std::array<std::atomic<uint64_t>, QuantileSketch::BucketsCount> buckets {};
+    };
+
+    // Padded at both ends so neighbouring heap blocks never share a cache line with the
+    // counters (over-aligned new is not available before C++17)
+    struct Shard
+    {
+        char frontPadding[64];
+        std::atomic<uint64_t> games {0U};
+        std::atomic<uint64_t> turns {0U};
+        std::atomic<uint64_t> spawnedBalls {0U};
+        std::array<std::atomic<uint64_t>, StatisticsSnapshot::LineTiers> lines {};
+        std::array<std::atomic<uint64_t>, StatisticsSnapshot::BoardCells> occupancy {};
+        std::array<std::atomic<uint64_t>, StatisticsSnapshot::BoardCells> clears {};
+        AtomicSketch scores;
+        AtomicSketch gameLengths;
+        char backPadding[64];
+    };
+
+    Shard& getLocalShard();
+
+    uint64_t m_id;
+    mutable std::mutex m_shardsMutex;
+    std::vector<std::unique_ptr<Shard>> m_shards;
+};
+
+}
+
+#endif
@@ -0,0 +1,245 @@
+#include "headless.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QThread>
+
+#include "differentialfuzzer.h"
+#include "featurestore.h"
+#include "game.h"
+#include "gameserver.h"
+#include "leaderboardmerge.h"
+#include "localclient.h"
+#include "positiondatabase.h"
+#include "puzzlesolver.h"
+#include "spectatorfeed.h"
+#include "tournament.h"
+
+namespace Qoolkie
+{
+
+namespace
+{
+
+constexpr const char* HeadlessOptions[] { "--server", "--client", "--tournament", "--solve", "--positions", "--fuzz", "--features",
+                                        "--merge-leaderboards", "--broadcast", "--spectate" };
+
+constexpr char TileSymbols[] = "kbgpury#.";
+constexpr std::chrono::milliseconds SpectatorPollInterval {20};
+
+int runServer(const QString& serverName, int shardsCount)
+{
+    QTextStream out(stdout);
+    GameServer server {shardsCount};
+    QLocalServer::removeServer(serverName);
+    if (!server.listen(serverName))
+    {
+        out << "Could not listen on " << serverName << ": " << server.errorString() << endl;
+        return 1;
+    }
+    out << "Serving on " << server.fullServerName() << " with " << shardsCount << " shards" << endl;
+    return QCoreApplication::exec();
+}
+
+// Greedy self-play published to a spectator feed, one move per interval
+int runBroadcast(const QString& filePath, uint32_t games, uint64_t seed, ColoursUsed colours, uint32_t intervalMs)
+{
+    QTextStream out(stdout);
+    SpectatorFeed feed {filePath};
+    Game game;
+    game.setSpectatorFeed(&feed);
+    GreedyPlayer player;
+    out << "Broadcasting on " << filePath << endl;
+
+    QElapsedTimer timer;
+    qint64 turnsNs {0};
+    uint64_t turns {0U};
+    for (uint32_t i = 0U; i < games; ++i)
+    {
+        game.start(colours, seed + i);
+        Rng rng {seed + i};
+        Move move;
+        while (!game.isGameOver() && player.chooseMove(game.getMap(), rng, move))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+            timer.start();
+            game.moveBall(move.fromRow, move.fromCol, move.destRow, move.destCol);
+            turnsNs += timer.nsecsElapsed();
+            ++turns;
+        }
+        out << "Game " << i + 1 << " scored " << game.getScore() << endl;
+    }
+    out << "Mean turn time " << (turns != 0U ? turnsNs / static_cast<qint64>(turns) : 0) << " ns over " << turns << " turns" << endl;
+    return 0;
+}
+
+void printSpectatedBoard(QTextStream& out, const std::array<TileContent, SpectatorSnapshot::TilesCount>& tiles,
+                         uint32_t turns, uint32_t score, bool isGameOver)
+{
+    out << "Turn " << turns << ", score " << score << (isGameOver ? ", game over" : "") << endl;
+    for (uint8_t i = 0U; i < GameMap::Rules::BoardSize; ++i)
+    {
+        for (uint8_t j = 0U; j < GameMap::Rules::BoardSize; ++j)
+        {
+            out << TileSymbols[static_cast<uint8_t>(tiles[i * GameMap::Rules::BoardSize + j])];
+        }
+        out << endl;
+    }
+}
+
+// Follows a spectator feed until interrupted, starting from its latest snapshot
+int runSpectator(const QString& filePath)
+{
+    QTextStream out(stdout);
+    SpectatorView view {filePath};
+    SpectatorSnapshot snapshot = view.snapshot();
+    std::array<TileContent, SpectatorSnapshot::TilesCount> tiles = snapshot.tiles;
+    uint64_t next = snapshot.sequence;
+    printSpectatedBoard(out, tiles, snapshot.turns, snapshot.score, snapshot.isGameOver);
+
+    SpectatorEvent event;
+    for (;;)
+    {
+        switch (view.read(next, event))
+        {
+            case SpectatorRead::Ready:
+                if (event.kind == SpectatorEventKind::Start)
+                {
+                    tiles.fill(TileContent::None);
+                }
+                for (uint8_t i = 0U; i < event.changesCount; ++i)
+                {
+                    const CellChange& change = event.changes[i];
+                    tiles[(change.row - 1) * GameMap::Rules::BoardSize + change.col - 1] = change.after;
+                }
+                printSpectatedBoard(out, tiles, event.turns, event.score, event.isGameOver);
+                ++next;
+                break;
+            case SpectatorRead::Pending:
+                std::this_thread::sleep_for(SpectatorPollInterval);
+                break;
+            case SpectatorRead::Lapped:
+                out << "Fell behind the game, skipping ahead" << endl;
+                snapshot = view.snapshot();
+                tiles = snapshot.tiles;
+                next = snapshot.sequence;
+                printSpectatedBoard(out, tiles, snapshot.turns, snapshot.score, snapshot.isGameOver);
+                break;
+        }
+    }
+}
+
+}
+
+bool isHeadlessInvocation(int argc, char** argv)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        for (auto&& option : HeadlessOptions)
+        {
+            if (std::strcmp(argv[i], option) == 0)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+int runHeadless(int argc, char** argv)
+{
+    QCoreApplication app {argc, argv};
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption serverOption("server", "Host game sessions on local socket <name>.", "name");
+    QCommandLineOption clientOption("client", "Play random moves against the server on <name>.", "name");
+    QCommandLineOption shardsOption("shards", "Event loop threads of the server.", "count",
+                                    QString::number(QThread::idealThreadCount()));
+    QCommandLineOption movesOption("moves", "Moves sent by the client.", "count", "1000");
+    QCommandLineOption tournamentOption("tournament", "Play the built-in strategies against the same seeds.");
+    QCommandLineOption gamesOption("games", "Games per strategy.", "count", "1000");
+    QCommandLineOption seedOption("seed", "First game seed.", "seed", "1");
+    QCommandLineOption coloursOption("colours", "Colours used, 5 or 7.", "count", "5");
+    QCommandLineOption solveOption("solve", "Find the shortest solution of a fixed-spawn puzzle.");
+    QCommandLineOption puzzleOption("puzzle", "Puzzle board, nine rows of '.kbgpury' tiles.", "file");
+    QCommandLineOption targetScoreOption("target-score", "Solve for this score instead of clearing the board.", "score", "0");
+    QCommandLineOption maxDepthOption("max-depth", "Longest solution searched for.", "moves", "8");
+    QCommandLineOption positionsOption("positions", "Index the positions of greedy self-play games in database <directory>.", "directory");
+    QCommandLineOption fuzzOption("fuzz", "Compare GameMap and Game with the optimized engines on generated boards and games.");
+    QCommandLineOption roundsOption("rounds", "Fuzzing rounds, each a batch of boards and one game.", "count", "1000");
+    QCommandLineOption replayMovesOption("replay-moves", "Longest game replayed per fuzzing round.", "moves", "200");
+    QCommandLineOption featuresOption("features", "Export board features of greedy self-play games to columnar file <file>.", "file");
+    QCommandLineOption mergeOption("merge-leaderboards", "Merge the leaderboard files and directories given as arguments into <file>, for the --colours mode.", "file");
+    QCommandLineOption topOption("top", "Entries kept by the merge, 0 for all.", "count", "0");
+    QCommandLineOption broadcastOption("broadcast", "Publish greedy self-play games to spectator feed <file>.", "file");
+    QCommandLineOption intervalOption("interval", "Pause before every broadcast move.", "ms", "100");
+    QCommandLineOption spectateOption("spectate", "Watch the game published to spectator feed <file>.", "file");
+    QCommandLineOption statsOption("stats", "Write tournament statistics to <prefix>.bin and <prefix>.csv.", "prefix");
+    parser.addOptions({serverOption, clientOption, shardsOption, movesOption,
+                       tournamentOption, gamesOption, seedOption, coloursOption,
+                       solveOption, puzzleOption, targetScoreOption, maxDepthOption, statsOption,
+                       positionsOption, fuzzOption, roundsOption, replayMovesOption, featuresOption,
+                       mergeOption, topOption, broadcastOption, intervalOption, spectateOption});
+    parser.addPositionalArgument("inputs", "Leaderboard files or directories to merge.", "[inputs...]");
+    parser.process(app);
+
+    if (parser.isSet(serverOption))
+    {
+        return runServer(parser.value(serverOption), std::max(1, parser.value(shardsOption).toInt()));
+    }
+    if (parser.isSet(clientOption))
+    {
+        return runClient(parser.value(clientOption), parser.value(movesOption).toInt());
+    }
+    ColoursUsed colours = parser.value(coloursOption).toInt() == 7 ? ColoursUsed::Seven : ColoursUsed::Five;
+    if (parser.isSet(tournamentOption))
+    {
+        return runTournament(parser.value(gamesOption).toUInt(), parser.value(seedOption).toULongLong(), colours,
+                             parser.value(statsOption));
+    }
+    if (parser.isSet(solveOption))
+    {
+        return runSolver(parser.value(puzzleOption), parser.value(seedOption).toULongLong(), colours,
+                         parser.value(targetScoreOption).toUInt(), static_cast<uint8_t>(parser.value(maxDepthOption).toUInt()));
+    }
+    if (parser.isSet(positionsOption))
+    {
+        return runPositionIndexer(parser.value(positionsOption), parser.value(gamesOption).toUInt(),
+                                  parser.value(seedOption).toULongLong(), colours);
+    }
+    if (parser.isSet(fuzzOption))
+    {
+        return runFuzzer(parser.value(roundsOption).toUInt(), parser.value(seedOption).toULongLong(),
+                         parser.value(replayMovesOption).toUInt());
+    }
+    if (parser.isSet(featuresOption))
+    {
+        return runFeatureExport(parser.value(featuresOption), parser.value(gamesOption).toUInt(),
+                                parser.value(seedOption).toULongLong(), colours);
+    }
+    if (parser.isSet(mergeOption))
+    {
+        return runLeaderboardMerge(parser.positionalArguments(), parser.value(mergeOption), colours,
+                                   parser.value(topOption).toULongLong());
+    }
+    if (parser.isSet(broadcastOption))
+    {
+        return runBroadcast(parser.value(broadcastOption), parser.value(gamesOption).toUInt(),
+                            parser.value(seedOption).toULongLong(), colours, parser.value(intervalOption).toUInt());
+    }
+    if (parser.isSet(spectateOption))
+    {
+        return runSpectator(parser.value(spectateOption));
+    }
+    parser.showHelp(1);
+    return 1;
+}
+
+}
@@ -0,0 +1,13 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+namespace Qoolkie
+{
+
+// Command line tools that run without a GUI, e.g. "Qoolkie --server kiosk --shards 4".
+bool isHeadlessInvocation(int argc, char** argv);
+int runHeadless(int argc, char** argv);
+
+}
+
+#endif
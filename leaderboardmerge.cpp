@@ -0,0 +1,703 @@
+#include "leaderboardmerge.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QSaveFile>
+#include <QTextStream>
+
+namespace Qoolkie
+{
+
+constexpr uint8_t LeaderboardMerger::NameBytes;
+constexpr uint32_t LeaderboardMerger::DefaultRunEntries;
+constexpr uint16_t LeaderboardMerger::MaxMergeWays;
+constexpr uint8_t LeaderboardMerger::TopEntries;
+
+namespace
+{
+
+constexpr uint32_t RankingMagic {0x52424C51}; // "QLBR"
+constexpr uint32_t RankingVersion {1U};
+// Magic, version, entries count, colours used
+constexpr uint32_t HeaderBytes {24U};
+constexpr uint32_t RecordBytes {sizeof(uint64_t) + LeaderboardMerger::NameBytes};
+constexpr size_t WriteBufferBytes {1U << 16};
+
+struct Record
+{
+    uint64_t score;
+    std::array<char, LeaderboardMerger::NameBytes> name;
+};
+
+void storeU32(uchar* target, uint32_t value) noexcept
+{
+    for (uint8_t i = 0U; i < 4U; ++i)
+    {
+        target[i] = static_cast<uchar>(value >> (8U * i));
+    }
+}
+
+void storeU64(uchar* target, uint64_t value) noexcept
+{
+    for (uint8_t i = 0U; i < 8U; ++i)
+    {
+        target[i] = static_cast<uchar>(value >> (8U * i));
+    }
+}
+
+uint32_t loadU32(const uchar* source) noexcept
+{
+    uint32_t value {0U};
+    for (uint8_t i = 0U; i < 4U; ++i)
+    {
+        value |= static_cast<uint32_t>(source[i]) << (8U * i);
+    }
+    return value;
+}
+
+uint64_t loadU64(const uchar* source) noexcept
+{
+    uint64_t value {0U};
+    for (uint8_t i = 0U; i < 8U; ++i)
+    {
+        value |= static_cast<uint64_t>(source[i]) << (8U * i);
+    }
+    return value;
+}
+
+void readRecord(const uchar* source, Record& record) noexcept
+{
+    record.score = loadU64(source);
+    std::memcpy(record.name.data(), source + sizeof(uint64_t), record.name.size());
+}
+
+void writeRecord(uchar* target, const Record& record) noexcept
+{
+    storeU64(target, record.score);
+    std::memcpy(target + sizeof(uint64_t), record.name.data(), record.name.size());
+}
+
+Record makeRecord(const QByteArray& name, uint64_t score) noexcept
+{
+    Record record;
+    record.score = score;
+    record.name.fill('\0');
+    // Cut on a character boundary so the name stays valid UTF-8
+    size_t length = std::min<size_t>(name.size(), LeaderboardMerger::NameBytes - 1U);
+    while (length > 0U && length < static_cast<size_t>(name.size()) && (name[static_cast<int>(length)] & 0xC0) == 0x80)
+    {
+        --length;
+    }
+    std::memcpy(record.name.data(), name.constData(), length);
+    return record;
+}
+
+std::string getName(const Record& record)
+{
+    return std::string(record.name.data(), strnlen(record.name.data(), record.name.size()));
+}
+
+// Best score first, ties by name, so identical submissions end up next to each other
+bool ranksBefore(const Record& lhs, const Record& rhs) noexcept
+{
+    if (lhs.score != rhs.score)
+    {
+        return lhs.score > rhs.score;
+    }
+    return std::memcmp(lhs.name.data(), rhs.name.data(), lhs.name.size()) < 0;
+}
+
+bool isSameSubmission(const Record& lhs, const Record& rhs) noexcept
+{
+    return lhs.score == rhs.score && lhs.name == rhs.name;
+}
+
+bool isJsonPath(const QString& filePath)
+{
+    return filePath.endsWith(".json", Qt::CaseInsensitive);
+}
+
+bool toColours(uint32_t value, ColoursUsed& colours) noexcept
+{
+    if (value != static_cast<uint32_t>(ColoursUsed::Five) && value != static_cast<uint32_t>(ColoursUsed::Seven))
+    {
+        return false;
+    }
+    colours = static_cast<ColoursUsed>(value);
+    return true;
+}
+
+enum class FileRead : uint8_t
+{
+    Read,
+    // Entries of the other colour mode, which don't rank against these
+    OtherColours,
+    // Neither format, or a JSON file that doesn't tell its colour mode
+    Unreadable
+};
+
+// Calls function for every entry of the colours mode in a binary ranking, shared
+// leaderboard or JSON highscores file. A file of the other mode or one that can't
+// be read or parsed yields no entries at all.
+template<typename Function>
+FileRead readLeaderboardFile(const QString& filePath, ColoursUsed colours, Function function)
+{
+    QFile file {filePath};
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return FileRead::Unreadable;
+    }
+    qint64 size = file.size();
+    ColoursUsed fileColours;
+    std::array<uchar, HeaderBytes> header {};
+    if (size >= HeaderBytes && file.read(reinterpret_cast<char*>(header.data()), HeaderBytes) == HeaderBytes &&
+        loadU32(header.data()) == RankingMagic)
+    {
+        uint64_t count = loadU64(header.data() + 8);
+        if (loadU32(header.data() + 4) != RankingVersion || !toColours(loadU32(header.data() + 16), fileColours) ||
+            static_cast<uint64_t>(size) != HeaderBytes + count * RecordBytes)
+        {
+            return FileRead::Unreadable;
+        }
+        if (fileColours != colours)
+        {
+            return FileRead::OtherColours;
+        }
+        const uchar* data = count != 0U ? file.map(0, size) : nullptr;
+        if (count != 0U && !data)
+        {
+            return FileRead::Unreadable;
+        }
+        Record record;
+        for (uint64_t i = 0U; i < count; ++i)
+        {
+            readRecord(data + HeaderBytes + i * RecordBytes, record);
+            function(record);
+        }
+        return FileRead::Read;
+    }
+
+    // Holds a table per mode, of which only the colours one is taken
+    std::vector<std::pair<std::string, uint64_t>> entries;
+    if (SharedLeaderboard::readFile(filePath, colours, entries))
+    {
+        for (auto&& entry : entries)
+        {
+            function(makeRecord(QByteArray(entry.first.data(), static_cast<int>(entry.first.size())), entry.second));
+        }
+        return FileRead::Read;
+    }
+
+    // Same layout as Highscore::save, scores stored as strings. Highscore keeps each
+    // mode in its own file, merged files say which mode they hold.
+    file.seek(0);
+    QJsonParseError error;
+    QJsonDocument document(QJsonDocument::fromJson(file.readAll(), &error));
+    if (error.error != QJsonParseError::NoError || !document.isObject())
+    {
+        return FileRead::Unreadable;
+    }
+    QJsonObject object = document.object();
+    QString fileName = QFileInfo(filePath).fileName();
+    uint32_t modeColours = object.contains("colours") ? static_cast<uint32_t>(object["colours"].toInt()) :
+                           fileName == "highscores_5.json" ? 5U : fileName == "highscores_7.json" ? 7U : 0U;
+    if (!toColours(modeColours, fileColours))
+    {
+        return FileRead::Unreadable;
+    }
+    if (fileColours != colours)
+    {
+        return FileRead::OtherColours;
+    }
+    QJsonArray highscores = object["highscores"].toArray();
+    for (int i = 0; i < highscores.size(); ++i)
+    {
+        QJsonObject highscore = highscores.at(i).toObject();
+        QJsonValue score = highscore["score"];
+        function(makeRecord(highscore["name"].toString().toUtf8(),
+                            score.isString() ? score.toString().toULongLong() : static_cast<uint64_t>(score.toDouble())));
+    }
+    return FileRead::Read;
+}
+
+// Only replaces filePath on close(), in one atomic rename, so a crash at any point
+// leaves the previous file whole; one never closed is dropped
+class OutputFile
+{
+public:
+    explicit OutputFile(const QString& filePath) : m_file(filePath)
+    {
+        if (!m_file.open(QIODevice::WriteOnly))
+        {
+            throw std::runtime_error("Could not create leaderboard file");
+        }
+        m_buffer.reserve(WriteBufferBytes);
+    }
+
+    OutputFile(const OutputFile&) = delete;
+    OutputFile& operator=(const OutputFile&) = delete;
+
+    void append(const char* data, size_t size)
+    {
+        if (m_buffer.size() + size > WriteBufferBytes)
+        {
+            flush();
+        }
+        m_buffer.insert(m_buffer.end(), data, data + size);
+    }
+
+    void flush()
+    {
+        if (!m_buffer.empty() && m_file.write(m_buffer.data(), m_buffer.size()) != static_cast<qint64>(m_buffer.size()))
+        {
+            throw std::runtime_error("Could not write leaderboard file");
+        }
+        m_buffer.clear();
+    }
+
+    QSaveFile& getFile() noexcept
+    {
+        return m_file;
+    }
+
+    void close()
+    {
+        flush();
+        if (!m_file.commit())
+        {
+            throw std::runtime_error("Could not replace leaderboard file");
+        }
+    }
+
+private:
+    QSaveFile m_file;
+    std::vector<char> m_buffer;
+};
+
+class RankingWriter
+{
+public:
+    RankingWriter(const QString& filePath, ColoursUsed colours) : m_output(filePath), m_colours(colours)
+    {
+        std::array<char, HeaderBytes> header {};
+        m_output.append(header.data(), header.size());
+    }
+
+    void append(const Record& record)
+    {
+        std::array<uchar, RecordBytes> data;
+        writeRecord(data.data(), record);
+        m_output.append(reinterpret_cast<const char*>(data.data()), data.size());
+        ++m_count;
+    }
+
+    void close()
+    {
+        m_output.flush();
+        std::array<uchar, HeaderBytes> header {};
+        storeU32(header.data(), RankingMagic);
+        storeU32(header.data() + 4, RankingVersion);
+        storeU64(header.data() + 8, m_count);
+        storeU32(header.data() + 16, static_cast<uint32_t>(m_colours));
+        QSaveFile& file = m_output.getFile();
+        if (!file.seek(0) || file.write(reinterpret_cast<const char*>(header.data()), header.size()) != HeaderBytes)
+        {
+            throw std::runtime_error("Could not write leaderboard file");
+        }
+        m_output.close();
+    }
+
+private:
+    OutputFile m_output;
+    ColoursUsed m_colours;
+    uint64_t m_count {0U};
+};
+
+// Streams the same document Highscore::save builds, so the result loads like any highscores
+// file, plus the colours used since its name needn't tell
+class JsonWriter
+{
+public:
+    JsonWriter(const QString& filePath, ColoursUsed colours) : m_output(filePath)
+    {
+        appendText("{\n    \"colours\": " + std::to_string(static_cast<uint32_t>(colours)) + ",\n    \"highscores\": [");
+    }
+
+    void append(const Record& record)
+    {
+        std::string text = m_isFirst ? "\n        {\n            \"name\": \"" : ",\n        {\n            \"name\": \"";
+        for (char c : getName(record))
+        {
+            if (c == '"' || c == '\\')
+            {
+                text += '\\';
+                text += c;
+            }
+            else if (static_cast<uchar>(c) < 0x20U)
+            {
+                static constexpr char Hex[] = "0123456789abcdef";
+                text += "\\u00";
+                text += Hex[(c >> 4) & 0x0F];
+                text += Hex[c & 0x0F];
+            }
+            else
+            {
+                text += c;
+            }
+        }
+        text += "\",\n            \"score\": \"" + std::to_string(record.score) + "\"\n        }";
+        appendText(text);
+        m_isFirst = false;
+    }
+
+    void close()
+    {
+        appendText("\n    ]\n}\n");
+        m_output.close();
+    }
+
+private:
+    void appendText(const std::string& text)
+    {
+        m_output.append(text.data(), text.size());
+    }
+
+    OutputFile m_output;
+    bool m_isFirst {true};
+};
+
+// Passes records on to output, keeping the first few for a summary
+template<typename Output>
+class TopRecorder
+{
+public:
+    TopRecorder(Output& output, std::vector<LeaderboardEntry>& top) : m_output(output), m_top(top)
+    {
+    }
+
+    void append(const Record& record)
+    {
+        if (m_top.size() < LeaderboardMerger::TopEntries)
+        {
+            m_top.push_back(LeaderboardEntry {getName(record), record.score});
+        }
+        m_output.append(record);
+    }
+
+private:
+    Output& m_output;
+    std::vector<LeaderboardEntry>& m_top;
+};
+
+void writeRun(std::vector<Record>& records, uint64_t limit, ColoursUsed colours, const QString& runPath)
+{
+    std::sort(records.begin(), records.end(), ranksBefore);
+    records.erase(std::unique(records.begin(), records.end(), isSameSubmission), records.end());
+    // Whatever is past the limit within one run is past it in the merged ranking too
+    if (limit != 0U && records.size() > limit)
+    {
+        records.resize(limit);
+    }
+    RankingWriter writer {runPath, colours};
+    for (auto&& record : records)
+    {
+        writer.append(record);
+    }
+    writer.close();
+}
+
+// K-way merge of sorted runs with a heap of run cursors, dropping repeated submissions
+template<typename Output>
+uint64_t mergeRuns(const std::vector<QString>& runPaths, uint64_t limit, Output& output)
+{
+    struct Source
+    {
+        const uchar* records;
+        uint64_t count;
+        uint64_t position;
+        Record current;
+    };
+
+    std::vector<Source> sources;
+    std::vector<std::unique_ptr<QFile>> runFiles;
+    for (auto&& runPath : runPaths)
+    {
+        runFiles.emplace_back(new QFile(runPath));
+        QFile& runFile = *runFiles.back();
+        if (!runFile.open(QIODevice::ReadOnly) || runFile.size() < HeaderBytes)
+        {
+            throw std::runtime_error("Could not open leaderboard run file");
+        }
+        const uchar* data = runFile.map(0, runFile.size());
+        if (!data || loadU32(data) != RankingMagic ||
+            static_cast<uint64_t>(runFile.size()) != HeaderBytes + loadU64(data + 8) * RecordBytes)
+        {
+            throw std::runtime_error("Corrupt leaderboard run file");
+        }
+        uint64_t count = loadU64(data + 8);
+        if (count != 0U)
+        {
+            sources.push_back(Source {data + HeaderBytes, count, 0U, Record {}});
+            readRecord(sources.back().records, sources.back().current);
+        }
+    }
+
+    auto isAfter = [&sources](size_t lhs, size_t rhs)
+    {
+        return ranksBefore(sources[rhs].current, sources[lhs].current);
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(isAfter)> heap {isAfter};
+    for (size_t i = 0U; i < sources.size(); ++i)
+    {
+        heap.push(i);
+    }
+
+    uint64_t written {0U};
+    Record last;
+    while (!heap.empty() && (limit == 0U || written < limit))
+    {
+        size_t index = heap.top();
+        heap.pop();
+        Source& source = sources[index];
+        if (written == 0U || !isSameSubmission(source.current, last))
+        {
+            output.append(source.current);
+            last = source.current;
+            ++written;
+        }
+        if (++source.position < source.count)
+        {
+            readRecord(source.records + source.position * RecordBytes, source.current);
+            heap.push(index);
+        }
+    }
+    return written;
+}
+
+// Runs function on every worker thread; the first exception thrown is rethrown once all are done
+template<typename Function>
+void runWorkers(unsigned threadsCount, Function function)
+{
+    std::exception_ptr failure;
+    std::mutex failureMutex;
+    auto worker = [&]()
+    {
+        try
+        {
+            function();
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock {failureMutex};
+            if (!failure)
+            {
+                failure = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 0U; i < threadsCount; ++i)
+    {
+        threads.emplace_back(worker);
+    }
+    for (auto&& thread : threads)
+    {
+        thread.join();
+    }
+    if (failure)
+    {
+        std::rethrow_exception(failure);
+    }
+}
+
+}
+
+QStringList LeaderboardMerger::expandInputs(const QStringList& inputPaths)
+{
+    QStringList filePaths;
+    for (auto&& inputPath : inputPaths)
+    {
+        if (!QFileInfo(inputPath).isDir())
+        {
+            filePaths.append(inputPath);
+            continue;
+        }
+        QDir directory {inputPath};
+        QStringList nameFilters {"highscores_*.json", "*.ranking", QFileInfo(SharedLeaderboard::getDefaultPath()).fileName()};
+        for (auto&& fileName : directory.entryList(nameFilters, QDir::Files, QDir::Name))
+        {
+            filePaths.append(directory.filePath(fileName));
+        }
+    }
+    return filePaths;
+}
+
+LeaderboardMerger::LeaderboardMerger(const QString& workDirectory, uint32_t runEntries, unsigned threadsCount) :
+    m_workDirectory(workDirectory),
+    m_runEntries(std::max(1U, runEntries)),
+    m_threadsCount(threadsCount != 0U ? threadsCount : std::max(1U, std::thread::hardware_concurrency()))
+{
+}
+
+QString LeaderboardMerger::getRunPath(uint32_t run) const
+{
+    return m_workDirectory + QDir::separator() + "run_" + QString::number(run) + ".ranking";
+}
+
+LeaderboardMergeStats LeaderboardMerger::merge(const QStringList& inputPaths, const QString& outputPath, ColoursUsed colours,
+                                               uint64_t limit)
+{
+    if (!QDir().mkpath(m_workDirectory))
+    {
+        throw std::runtime_error("Could not create leaderboard work directory");
+    }
+    const QStringList filePaths = expandInputs(inputPaths);
+
+    std::atomic<uint32_t> filesRead {0U};
+    std::atomic<uint32_t> filesSkipped {0U};
+    std::atomic<uint32_t> filesOtherColours {0U};
+    std::atomic<uint64_t> entriesRead {0U};
+    std::atomic<uint32_t> nextRun {0U};
+    std::mutex runsMutex;
+    std::vector<QString> runPaths;
+
+    // Every worker fills its own run buffer from whole files and spills it when full
+    std::atomic<int> nextFile {0};
+    runWorkers(m_threadsCount, [&]()
+    {
+        std::vector<Record> records;
+        records.reserve(m_runEntries);
+        auto spill = [&]()
+        {
+            if (records.empty())
+            {
+                return;
+            }
+            QString runPath = getRunPath(nextRun++);
+            writeRun(records, limit, colours, runPath);
+            records.clear();
+            std::lock_guard<std::mutex> lock {runsMutex};
+            runPaths.push_back(runPath);
+        };
+        for (int i = nextFile++; i < filePaths.size(); i = nextFile++)
+        {
+            uint64_t entries {0U};
+            FileRead fileRead = readLeaderboardFile(filePaths.at(i), colours, [&](const Record& record)
+            {
+                records.push_back(record);
+                ++entries;
+                if (records.size() >= m_runEntries)
+                {
+                    spill();
+                }
+            });
+            ++(fileRead == FileRead::Read ? filesRead : fileRead == FileRead::OtherColours ? filesOtherColours : filesSkipped);
+            entriesRead += entries;
+        }
+        spill();
+    });
+
+    LeaderboardMergeStats stats;
+    stats.filesRead = filesRead;
+    stats.filesSkipped = filesSkipped;
+    stats.filesOtherColours = filesOtherColours;
+    stats.entriesRead = entriesRead;
+    stats.runsCount = static_cast<uint32_t>(runPaths.size());
+
+    // Too many runs to keep open at once are merged into fewer, larger runs first
+    while (runPaths.size() > MaxMergeWays)
+    {
+        std::vector<QString> mergedPaths((runPaths.size() + MaxMergeWays - 1U) / MaxMergeWays);
+        std::atomic<size_t> nextGroup {0U};
+        runWorkers(std::min<unsigned>(m_threadsCount, mergedPaths.size()), [&]()
+        {
+            for (size_t group = nextGroup++; group < mergedPaths.size(); group = nextGroup++)
+            {
+                auto first = runPaths.begin() + group * MaxMergeWays;
+                std::vector<QString> groupPaths(first, first + std::min<size_t>(MaxMergeWays, runPaths.end() - first));
+                mergedPaths[group] = getRunPath(nextRun++);
+                RankingWriter writer {mergedPaths[group], colours};
+                mergeRuns(groupPaths, limit, writer);
+                writer.close();
+                for (auto&& runPath : groupPaths)
+                {
+                    QFile::remove(runPath);
+                }
+            }
+        });
+        runPaths = mergedPaths;
+        ++stats.mergePasses;
+    }
+
+    if (isJsonPath(outputPath))
+    {
+        JsonWriter writer {outputPath, colours};
+        TopRecorder<JsonWriter> recorder {writer, stats.top};
+        stats.entriesWritten = mergeRuns(runPaths, limit, recorder);
+        writer.close();
+    }
+    else
+    {
+        RankingWriter writer {outputPath, colours};
+        TopRecorder<RankingWriter> recorder {writer, stats.top};
+        stats.entriesWritten = mergeRuns(runPaths, limit, recorder);
+        writer.close();
+    }
+    ++stats.mergePasses;
+
+    for (auto&& runPath : runPaths)
+    {
+        QFile::remove(runPath);
+    }
+    QDir().rmdir(m_workDirectory);
+    return stats;
+}
+
+int runLeaderboardMerge(const QStringList& inputPaths, const QString& outputPath, ColoursUsed colours, uint64_t limit)
+{
+    QTextStream out(stdout);
+    QElapsedTimer timer;
+    timer.start();
+
+    LeaderboardMerger merger {outputPath + ".runs"};
+    LeaderboardMergeStats stats = merger.merge(inputPaths, outputPath, colours, limit);
+
+    out << "Read " << stats.entriesRead << " entries from " << stats.filesRead << " files";
+    if (stats.filesSkipped != 0U)
+    {
+        out << ", skipped " << stats.filesSkipped << " unreadable files";
+    }
+    if (stats.filesOtherColours != 0U)
+    {
+        out << ", left out " << stats.filesOtherColours << " files of the other colour mode";
+    }
+    out << endl;
+    out << "Wrote " << stats.entriesWritten << " entries to " << outputPath << " in " << timer.elapsed() << " ms ("
+        << stats.runsCount << " runs, " << stats.mergePasses << " merge passes)" << endl;
+
+    // Leaderboards only get big when the full ranking is kept, so just the top is shown
+    for (size_t i = 0U; i < stats.top.size(); ++i)
+    {
+        out << i + 1 << ". " << QString::fromStdString(stats.top[i].name) << " \t" << stats.top[i].score << endl;
+    }
+    return stats.filesSkipped == 0U ? 0 : 1;
+}
+
+}
@@ -0,0 +1,74 @@
+#ifndef LEADERBOARDMERGE_H
+#define LEADERBOARDMERGE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <QString>
+#include <QStringList>
+
+#include "sharedleaderboard.h"
+
+namespace Qoolkie
+{
+
+struct LeaderboardEntry
+{
+    std::string name;
+    uint64_t score;
+};
+
+struct LeaderboardMergeStats
+{
+    uint32_t filesRead {0U};
+    uint32_t filesSkipped {0U};
+    uint32_t filesOtherColours {0U};
+    uint64_t entriesRead {0U};
+    uint32_t runsCount {0U};
+    uint32_t mergePasses {0U};
+    uint64_t entriesWritten {0U};
+    // The first TopEntries entries written, best first
+    std::vector<LeaderboardEntry> top;
+};
+
+// Consolidates any number of leaderboard files into one ranking by score, then name,
+// of a single colour mode. Inputs are JSON highscores as Highscore writes them, shared
+// leaderboard files or binary rankings as written here. Files of the other mode are
+// left out; a JSON file whose mode is neither in its name nor in the document is
+// skipped. Worker threads read the inputs into sorted runs of at most runEntries
+// entries and spill them to the work directory; the runs are then k-way merged, at
+// most MaxMergeWays at a time, so memory stays bounded however many and however large
+// the inputs are. Identical submissions, same name and score, are kept once. Names
+// are cut to NameBytes - 1 bytes, as in SharedLeaderboard.
+class LeaderboardMerger
+{
+public:
+    static constexpr uint8_t NameBytes {SharedLeaderboard::NameBytes};
+    static constexpr uint32_t DefaultRunEntries {1U << 16};
+    static constexpr uint16_t MaxMergeWays {64};
+    static constexpr uint8_t TopEntries {10};
+
+    // Directories passed as inputs stand for the leaderboard files in them
+    static QStringList expandInputs(const QStringList& inputPaths);
+
+    explicit LeaderboardMerger(const QString& workDirectory, uint32_t runEntries = DefaultRunEntries,
+                               unsigned threadsCount = 0U);
+
+    // A limit of 0 keeps the whole ranking. The output is JSON when outputPath ends
+    // in .json, a binary ranking otherwise; it only replaces outputPath once complete.
+    LeaderboardMergeStats merge(const QStringList& inputPaths, const QString& outputPath, ColoursUsed colours,
+                                uint64_t limit);
+
+private:
+    QString getRunPath(uint32_t run) const;
+
+    QString m_workDirectory;
+    uint32_t m_runEntries;
+    unsigned m_threadsCount;
+};
+
+int runLeaderboardMerge(const QStringList& inputPaths, const QString& outputPath, ColoursUsed colours, uint64_t limit);
+
+}
+
+#endif
@@ -0,0 +1,161 @@
+#include "localclient.h"
+
+#include <algorithm>
+#include <vector>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+#include "rng.h"
+
+namespace Qoolkie
+{
+
+constexpr uint8_t LocalClient::BoardRows;
+constexpr uint8_t LocalClient::BoardCols;
+
+LocalClient::LocalClient()
+{
+    m_board.fill(TileContent::None);
+}
+
+bool LocalClient::connectToServer(const QString& serverName, int timeoutMs)
+{
+    m_socket.connectToServer(serverName);
+    return m_socket.waitForConnected(timeoutMs);
+}
+
+bool LocalClient::newGame(ColoursUsed colours, Protocol::TurnDiff& diff)
+{
+    return exchange(Protocol::encodeNewGame(colours), diff);
+}
+
+bool LocalClient::move(uint8_t fromRow, uint8_t fromCol, uint8_t destRow, uint8_t destCol, Protocol::TurnDiff& diff)
+{
+    return exchange(Protocol::encodeMove(fromRow, fromCol, destRow, destCol), diff);
+}
+
+bool LocalClient::exchange(const QByteArray& frame, Protocol::TurnDiff& diff)
+{
+    m_socket.write(frame);
+    if (!m_socket.waitForBytesWritten(3000))
+    {
+        return false;
+    }
+
+    QByteArray payload;
+    while (!Protocol::takeFrame(m_buffer, payload))
+    {
+        if (!m_socket.waitForReadyRead(3000))
+        {
+            return false;
+        }
+        m_buffer.append(m_socket.readAll());
+    }
+    if (!Protocol::decodeTurnDiff(payload, diff))
+    {
+        return false;
+    }
+    applyDiff(diff);
+    return true;
+}
+
+void LocalClient::applyDiff(const Protocol::TurnDiff& diff)
+{
+    if (diff.flags & Protocol::BoardResetFlag)
+    {
+        m_board.fill(TileContent::None);
+    }
+    for (auto&& tile : diff.tiles)
+    {
+        if (tile.first < m_board.size())
+        {
+            m_board[tile.first] = tile.second;
+        }
+    }
+    m_score = diff.score;
+    m_isGameOver = (diff.flags & Protocol::GameOverFlag) != 0U;
+}
+
+TileContent LocalClient::getTileContent(uint8_t rowIdx, uint8_t colIdx) const noexcept
+{
+    return m_board[rowIdx * BoardCols + colIdx];
+}
+
+uint32_t LocalClient::getScore() const noexcept
+{
+    return m_score;
+}
+
+bool LocalClient::isGameOver() const noexcept
+{
+    return m_isGameOver;
+}
+
+int runClient(const QString& serverName, int movesCount)
+{
+    QTextStream out(stdout);
+    LocalClient client;
+    if (!client.connectToServer(serverName))
+    {
+        out << "Could not connect to " << serverName << endl;
+        return 1;
+    }
+
+    Protocol::TurnDiff diff;
+    if (!client.newGame(ColoursUsed::Five, diff))
+    {
+        out << "Server did not answer" << endl;
+        return 1;
+    }
+
+    Rng rng {static_cast<uint64_t>(QDateTime::currentMSecsSinceEpoch())};
+    std::vector<qint64> latencies;
+    latencies.reserve(movesCount);
+    uint32_t gamesPlayed {1U};
+    uint32_t rejected {0U};
+    QElapsedTimer timer;
+
+    for (int i = 0; i < movesCount; ++i)
+    {
+        std::vector<uint8_t> balls;
+        std::vector<uint8_t> freeTiles;
+        for (uint8_t cell = 0U; cell < LocalClient::BoardRows * LocalClient::BoardCols; ++cell)
+        {
+            bool isFree = client.getTileContent(cell / LocalClient::BoardCols, cell % LocalClient::BoardCols) == TileContent::None;
+            (isFree ? freeTiles : balls).push_back(cell);
+        }
+        if (client.isGameOver() || balls.empty() || freeTiles.empty())
+        {
+            client.newGame(ColoursUsed::Five, diff);
+            ++gamesPlayed;
+            continue;
+        }
+
+        uint8_t from = balls[rng.nextBelow(static_cast<uint32_t>(balls.size()))];
+        uint8_t dest = freeTiles[rng.nextBelow(static_cast<uint32_t>(freeTiles.size()))];
+        timer.start();
+        if (!client.move(from / LocalClient::BoardCols, from % LocalClient::BoardCols,
+                         dest / LocalClient::BoardCols, dest % LocalClient::BoardCols, diff))
+        {
+            out << "Connection lost" << endl;
+            return 1;
+        }
+        latencies.push_back(timer.nsecsElapsed());
+        if (diff.flags & Protocol::MoveRejectedFlag)
+        {
+            ++rejected;
+        }
+    }
+
+    if (!latencies.empty())
+    {
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&latencies](double p) { return latencies[static_cast<size_t>(p * (latencies.size() - 1))] / 1000.0; };
+        out << "moves: " << latencies.size() << ", rejected: " << rejected << ", games: " << gamesPlayed << endl;
+        out << "latency us p50: " << percentile(0.5) << ", p99: " << percentile(0.99) << ", max: " << percentile(1.0) << endl;
+    }
+    return 0;
+}
+
+}
@@ -0,0 +1,47 @@
+#ifndef LOCALCLIENT_H
+#define LOCALCLIENT_H
+
+#include <cstdint>
+#include <array>
+#include <QLocalSocket>
+#include <QString>
+
+#include "protocol.h"
+
+namespace Qoolkie
+{
+
+// Blocking stand-in for a kiosk screen: talks the server protocol and mirrors
+// the board from the received turn diffs.
+class LocalClient
+{
+public:
+    static constexpr uint8_t BoardRows {GameMap::Rules::BoardSize};
+    static constexpr uint8_t BoardCols {GameMap::Rules::BoardSize};
+
+    LocalClient();
+
+    bool connectToServer(const QString& serverName, int timeoutMs = 3000);
+    bool newGame(ColoursUsed colours, Protocol::TurnDiff& diff);
+    bool move(uint8_t fromRow, uint8_t fromCol, uint8_t destRow, uint8_t destCol, Protocol::TurnDiff& diff);
+
+    TileContent getTileContent(uint8_t rowIdx, uint8_t colIdx) const noexcept;
+    uint32_t getScore() const noexcept;
+    bool isGameOver() const noexcept;
+
+private:
+    bool exchange(const QByteArray& frame, Protocol::TurnDiff& diff);
+    void applyDiff(const Protocol::TurnDiff& diff);
+
+    QLocalSocket m_socket;
+    QByteArray m_buffer;
+    std::array<TileContent, BoardRows * BoardCols> m_board;
+    uint32_t m_score {0U};
+    bool m_isGameOver {false};
+};
+
+int runClient(const QString& serverName, int movesCount);
+
+}
+
+#endif
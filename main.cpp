@@ -1,17 +1,33 @@
 #include <cstdlib>
 #include <ctime>
 #include <memory>
+#include <stdexcept>
 #include <QApplication>
 #include <mainwindow.h>
 #include <gamemap.h>
 #include <game.h>
+#include <headless.h>
 
 int main(int argc, char **argv)
 {
     std::srand(std::time(nullptr));
+    if (Qoolkie::isHeadlessInvocation(argc, argv))
+    {
+        return Qoolkie::runHeadless(argc, argv);
+    }
 
     QApplication a{argc, argv};
     Qoolkie::Game game;
+    // Another instance already publishing to the feed keeps it, this one just isn't watched
+    std::unique_ptr<Qoolkie::SpectatorFeed> feed;
+    try
+    {
+        feed.reset(new Qoolkie::SpectatorFeed(Qoolkie::SpectatorFeed::getDefaultPath()));
+        game.setSpectatorFeed(feed.get());
+    }
+    catch (const std::runtime_error&)
+    {
+    }
     MainWindow w {game};
     w.show();
 
@@ -3,6 +3,8 @@
 #include <QInputDialog>
 #include <QMessageBox>
 #include <QDir>
+#include <QKeySequence>
+#include <QShortcut>
 #include <QString>
 
 #include <QDebug>
@@ -17,12 +19,17 @@ MainWindow::MainWindow(Qoolkie::Game& game, QWidget* parent) : QMainWindow(paren
     connect(m_ui->actionWyniki5, SIGNAL(triggered()), this, SLOT(showHighscoresFor5Colors()));
     connect(m_ui->actionWyniki7, SIGNAL(triggered()), this, SLOT(showHighscoresFor7Colors()));
 
-    connect(&m_game, SIGNAL(qoolkieGenerated(uint8_t,uint8_t,Qoolkie::TileContent)), this, SLOT(onQoolkieGenerated(uint8_t,uint8_t,Qoolkie::TileContent)));
-    connect(&m_game, SIGNAL(focusChanged(uint8_t,uint8_t,Qoolkie::TileContent)), this, SLOT(onFocusChanged(uint8_t,uint8_t,Qoolkie::TileContent)));
+    connect(&m_game, SIGNAL(ballMoved(Qoolkie::TilePath,Qoolkie::TileContent)), &m_animations, SLOT(onBallMoved(Qoolkie::TilePath,Qoolkie::TileContent)));
+    connect(&m_game, SIGNAL(qoolkieGenerated(uint8_t,uint8_t,Qoolkie::TileContent)), &m_animations, SLOT(onQoolkieGenerated(uint8_t,uint8_t,Qoolkie::TileContent)));
+    connect(&m_game, SIGNAL(focusChanged(uint8_t,uint8_t,Qoolkie::TileContent)), &m_animations, SLOT(onFocusChanged(uint8_t,uint8_t,Qoolkie::TileContent)));
+    connect(&m_game, SIGNAL(tileCleared(uint8_t,uint8_t)), &m_animations, SLOT(onTileCleared(uint8_t,uint8_t)));
+    connect(&m_animations, SIGNAL(tileChanged(uint8_t,uint8_t,Qoolkie::TileContent,bool,qreal)), this, SLOT(onTileChanged(uint8_t,uint8_t,Qoolkie::TileContent,bool,qreal)));
     connect(&m_game, SIGNAL(scoreChanged(uint32_t)), this, SLOT(onScoreChanged(uint32_t)));
-    connect(&m_game, SIGNAL(tileCleared(uint8_t,uint8_t)), this, SLOT(onTileCleared(uint8_t,uint8_t)));
     connect(&m_game, SIGNAL(gameOver()), this, SLOT(onGameFinished()));
 
+    new QShortcut(QKeySequence::Undo, this, SLOT(undoTurn()));
+    new QShortcut(QKeySequence::Redo, this, SLOT(redoTurn()));
+
     initGameMap();
 }
 
@@ -54,7 +61,7 @@ void MainWindow::initGameMap()
     }
 }
 
-void MainWindow::setTileIcon(QString imagePath, uint8_t rowIdx, uint8_t colIdx)
+void MainWindow::setTileIcon(QString imagePath, uint8_t rowIdx, uint8_t colIdx, qreal scale)
 {
     QLayoutItem* layoutItem = m_ui->gameMap->itemAtPosition(rowIdx, colIdx);
     if (layoutItem != nullptr)
@@ -63,7 +70,14 @@ void MainWindow::setTileIcon(QString imagePath, uint8_t rowIdx, uint8_t colIdx)
         if (widget != nullptr)
         {
             QPushButton* tile = dynamic_cast<QPushButton*>(widget);
-            tile->setIcon(QIcon{QPixmap{imagePath}});
+            auto icon = m_icons.find(imagePath);
+            if (icon == m_icons.end())
+            {
+                icon = m_icons.insert(imagePath, QIcon{QPixmap{imagePath}});
+            }
+            int sizePx = qRound(TileSizePx * scale);
+            tile->setIcon(*icon);
+            tile->setIconSize(QSize(sizePx, sizePx));
         }
     }
 }
@@ -95,24 +109,20 @@ void MainWindow::cleanTiles()
     }
 }
 
-void MainWindow::onQoolkieGenerated(uint8_t x, uint8_t y, TileContent content)
+void MainWindow::onTileChanged(uint8_t x, uint8_t y, TileContent content, bool isFocused, qreal scale)
 {
-    QString iconPath;
-    iconPath.append(QString(Game::ResourcesPath));
-    iconPath.append(Game::convertContentToString(content));
-    iconPath.append(".png");
-
-    setTileIcon(iconPath, x, y);
-}
+    if (content == TileContent::None)
+    {
+        cleanTile(x, y);
+        return;
+    }
 
-void MainWindow::onFocusChanged(uint8_t x, uint8_t y, TileContent content)
-{
     QString iconPath;
     iconPath.append(QString(Game::ResourcesPath));
     iconPath.append(Game::convertContentToString(content));
-    iconPath.append("_f.png");
+    iconPath.append(isFocused ? "_f.png" : ".png");
 
-    setTileIcon(iconPath, x, y);
+    setTileIcon(iconPath, x, y, scale);
 }
 
 void MainWindow::onScoreChanged(uint32_t score)
@@ -120,11 +130,6 @@ void MainWindow::onScoreChanged(uint32_t score)
     updateScore(score);
 }
 
-void MainWindow::onTileCleared(uint8_t x, uint8_t y)
-{
-    cleanTile(x, y);
-}
-
 void MainWindow::onGameFinished()
 {
     QString name = showInputBox("Zapisz wynik", "Przegrałeś. Podaj swoje imię i zapisz wynik.");
@@ -152,6 +157,7 @@ void MainWindow::onTileClicked()
 
 void MainWindow::startGameWith5Colors()
 {
+    m_animations.reset();
     cleanTiles();
     updateScore(0U);
     m_game.start(ColoursUsed::Five);
@@ -159,6 +165,7 @@ void MainWindow::startGameWith5Colors()
 
 void MainWindow::startGameWith7Colors()
 {
+    m_animations.reset();
     cleanTiles();
     updateScore(0U);
     m_game.start(ColoursUsed::Seven);
@@ -176,6 +183,16 @@ void MainWindow::showHighscoresFor7Colors()
     showMessageBox(highscores.isEmpty() ? "Brak wyników" : "Najlepsze wyniki", highscores);
 }
 
+void MainWindow::undoTurn()
+{
+    m_game.undo();
+}
+
+void MainWindow::redoTurn()
+{
+    m_game.redo();
+}
+
 int MainWindow::showMessageBox(const QString& title, const QString& message)
 {
     QFont font;
@@ -1,7 +1,10 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include <QHash>
+#include <QIcon>
 #include <QMainWindow>
+#include "animationscheduler.h"
 #include "game.h"
 
 namespace Ui
@@ -17,7 +20,7 @@ public:
     MainWindow(Qoolkie::Game& game, QWidget *parent = nullptr);
     ~MainWindow() noexcept;
 
-    void setTileIcon(QString imagePath, uint8_t rowIdx, uint8_t colIdx);
+    void setTileIcon(QString imagePath, uint8_t rowIdx, uint8_t colIdx, qreal scale = 1.0);
     void cleanTile(uint8_t rowIdx, uint8_t colIdx);
     void cleanTiles();
 
@@ -25,10 +28,8 @@ public:
     int showMessageBox(const QString& title, const QString& message);
 
 public slots:
-    void onQoolkieGenerated(uint8_t x, uint8_t y, Qoolkie::TileContent content);
-    void onFocusChanged(uint8_t x, uint8_t y, Qoolkie::TileContent content);
+    void onTileChanged(uint8_t x, uint8_t y, Qoolkie::TileContent content, bool isFocused, qreal scale);
     void onScoreChanged(uint32_t score);
-    void onTileCleared(uint8_t x, uint8_t y);
     void onGameFinished();
 
     void onTileClicked();
@@ -37,12 +38,17 @@ public slots:
     void startGameWith7Colors();
     void showHighscoresFor5Colors();
     void showHighscoresFor7Colors();
+    void undoTurn();
+    void redoTurn();
 
 private:
     static constexpr uint8_t TileSizePx {60};
 
     Qoolkie::Game& m_game;
     Ui::MainWindow* m_ui;
+    Qoolkie::AnimationScheduler m_animations;
+    // Animated tiles are redrawn every frame, decode each image only once
+    QHash<QString, QIcon> m_icons;
 
     void initGameMap();
     void updateScore(uint32_t score);
@@ -0,0 +1,188 @@
+#include "player.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <queue>
+
+namespace Qoolkie
+{
+
+void collectLegalMoves(const GameMap& map, std::vector<Move>& moves)
+{
+    moves.clear();
+    const uint8_t rows = map.getRowsCount();
+    const uint8_t cols = map.getColsCount();
+
+    // Label the free regions, a ball can reach exactly the regions touching it
+    std::vector<std::vector<int>> labels(rows + 2, std::vector<int>(cols + 2, -1));
+    int labelsCount {0};
+    for (uint8_t i = 1U; i <= rows; ++i)
+    {
+        for (uint8_t j = 1U; j <= cols; ++j)
+        {
+            if (map.isTileOccupied(i, j) || labels[i][j] != -1)
+            {
+                continue;
+            }
+            std::queue<std::pair<uint8_t, uint8_t>> set;
+            set.push(std::make_pair(i, j));
+            labels[i][j] = labelsCount;
+            while (!set.empty())
+            {
+                auto elem = set.front();
+                set.pop();
+                const std::array<std::pair<uint8_t, uint8_t>, 4> neighbours { std::make_pair(elem.first - 1, elem.second),
+                                                                              std::make_pair(elem.first, elem.second - 1),
+                                                                              std::make_pair(elem.first + 1, elem.second),
+                                                                              std::make_pair(elem.first, elem.second + 1) };
+                for (auto&& n : neighbours)
+                {
+                    if (!map.isTileOccupied(n.first, n.second) && labels[n.first][n.second] == -1)
+                    {
+                        labels[n.first][n.second] = labelsCount;
+                        set.push(n);
+                    }
+                }
+            }
+            ++labelsCount;
+        }
+    }
+
+    for (uint8_t i = 1U; i <= rows; ++i)
+    {
+        for (uint8_t j = 1U; j <= cols; ++j)
+        {
+            if (!map.isTileOccupied(i, j))
+            {
+                continue;
+            }
+            const std::array<int, 4> touching { labels[i - 1][j], labels[i][j - 1], labels[i + 1][j], labels[i][j + 1] };
+            for (uint8_t k = 1U; k <= rows; ++k)
+            {
+                for (uint8_t l = 1U; l <= cols; ++l)
+                {
+                    int label = labels[k][l];
+                    if (label != -1 && std::find(touching.begin(), touching.end(), label) != touching.end())
+                    {
+                        moves.push_back(Move {static_cast<uint8_t>(i - 1), static_cast<uint8_t>(j - 1),
+                                              static_cast<uint8_t>(k - 1), static_cast<uint8_t>(l - 1)});
+                    }
+                }
+            }
+        }
+    }
+}
+
+std::string RandomPlayer::getName() const
+{
+    return "random";
+}
+
+bool RandomPlayer::chooseMove(const GameMap& map, Rng& rng, Move& move)
+{
+    collectLegalMoves(map, m_moves);
+    if (m_moves.empty())
+    {
+        return false;
+    }
+    move = m_moves[rng.nextBelow(static_cast<uint32_t>(m_moves.size()))];
+    return true;
+}
+
+std::string GreedyPlayer::getName() const
+{
+    return "greedy";
+}
+
+bool GreedyPlayer::chooseMove(const GameMap& map, Rng& rng, Move& move)
+{
+    collectLegalMoves(map, m_moves);
+    if (m_moves.empty())
+    {
+        return false;
+    }
+
+    GameMap work = map;
+    size_t bestLength {0U};
+    uint32_t ties {0U};
+    for (auto&& candidate : m_moves)
+    {
+        uint8_t x = candidate.fromRow + 1;
+        uint8_t y = candidate.fromCol + 1;
+        uint8_t destX = candidate.destRow + 1;
+        uint8_t destY = candidate.destCol + 1;
+
+        TileContent content = work.getTileContent(x, y);
+        work.setTileContent(x, y, TileContent::None);
+        work.setTileContent(destX, destY, content);
+        size_t length = work.checkForScore(destX, destY, content).size();
+        work.setTileContent(destX, destY, TileContent::None);
+        work.setTileContent(x, y, content);
+
+        if (length > bestLength)
+        {
+            bestLength = length;
+            ties = 1U;
+            move = candidate;
+        }
+        else if (length == bestLength && rng.nextBelow(++ties) == 0U)
+        {
+            move = candidate;
+        }
+    }
+    return true;
+}
+
+std::string PotentialPlayer::getName() const
+{
+    return "potential";
+}
+
+bool PotentialPlayer::chooseMove(const GameMap& map, Rng& rng, Move& move)
+{
+    collectLegalMoves(map, m_moves);
+    if (m_moves.empty())
+    {
+        return false;
+    }
+
+    GameMap work = map;
+    size_t bestLength {0U};
+    int64_t bestGain {std::numeric_limits<int64_t>::min()};
+    uint32_t ties {0U};
+    for (auto&& candidate : m_moves)
+    {
+        uint8_t x = candidate.fromRow + 1;
+        uint8_t y = candidate.fromCol + 1;
+        uint8_t destX = candidate.destRow + 1;
+        uint8_t destY = candidate.destCol + 1;
+
+        TileContent content = work.getTileContent(x, y);
+        work.updateLinePotential();
+        int64_t before = work.getLinePotential(content);
+        work.setTileContent(x, y, TileContent::None);
+        work.setTileContent(destX, destY, content);
+        size_t length = work.checkForScore(destX, destY, content).size();
+        length = GameMap::Rules::isScoringLine(length) ? length : 0U;
+        work.updateLinePotential();
+        int64_t gain = static_cast<int64_t>(work.getLinePotential(content)) - before;
+        work.setTileContent(destX, destY, TileContent::None);
+        work.setTileContent(x, y, content);
+
+        if (length > bestLength || (length == bestLength && gain > bestGain))
+        {
+            bestLength = length;
+            bestGain = gain;
+            ties = 1U;
+            move = candidate;
+        }
+        else if (length == bestLength && gain == bestGain && rng.nextBelow(++ties) == 0U)
+        {
+            move = candidate;
+        }
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,73 @@
+#ifndef PLAYER_H
+#define PLAYER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gamemap.h"
+#include "rng.h"
+
+namespace Qoolkie
+{
+
+// Board coordinates are 0-based, as in Game::moveBall.
+struct Move
+{
+    uint8_t fromRow;
+    uint8_t fromCol;
+    uint8_t destRow;
+    uint8_t destCol;
+};
+
+// Every move GameMap::findPath allows on the board, found with one labelling of the free regions
+void collectLegalMoves(const GameMap& map, std::vector<Move>& moves);
+
+// A strategy picking the next move from a read-only view of the board. Any randomness
+// has to come from the supplied generator, so games stay reproducible from their seed.
+class Player
+{
+public:
+    virtual ~Player() = default;
+
+    virtual std::string getName() const = 0;
+    // Returns false when there's no legal move left
+    virtual bool chooseMove(const GameMap& map, Rng& rng, Move& move) = 0;
+};
+
+class RandomPlayer : public Player
+{
+public:
+    std::string getName() const override;
+    bool chooseMove(const GameMap& map, Rng& rng, Move& move) override;
+
+private:
+    std::vector<Move> m_moves;
+};
+
+// Picks the move giving the longest line through the moved ball, scoring lines first
+class GreedyPlayer : public Player
+{
+public:
+    std::string getName() const override;
+    bool chooseMove(const GameMap& map, Rng& rng, Move& move) override;
+
+private:
+    std::vector<Move> m_moves;
+};
+
+// Scores like GreedyPlayer, otherwise picks the move raising its colour's line
+// potential the most, read off GameMap::getLinePotential
+class PotentialPlayer : public Player
+{
+public:
+    std::string getName() const override;
+    bool chooseMove(const GameMap& map, Rng& rng, Move& move) override;
+
+private:
+    std::vector<Move> m_moves;
+};
+
+}
+
+#endif
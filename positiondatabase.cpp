@@ -0,0 +1,574 @@
+#include "positiondatabase.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QSaveFile>
+#include <QTextStream>
+
+#include "game.h"
+#include "player.h"
+
+namespace Qoolkie
+{
+
+constexpr uint8_t PositionDatabase::BoardSize;
+constexpr uint8_t PositionDatabase::KeyBytes;
+constexpr uint8_t PositionDatabase::RecordBytes;
+constexpr uint16_t PositionDatabase::FanoutSize;
+constexpr uint32_t PositionDatabase::HeaderBytes;
+
+namespace
+{
+
+constexpr uint32_t DatabaseMagic {0x42445051}; // "QPDB"
+constexpr uint32_t DatabaseVersion {1U};
+constexpr size_t WriteBufferBytes {1U << 16};
+// Same player stream as the tournament, so indexed games replay its greedy games
+constexpr uint64_t PlayerSeedSalt {0xA5A5A5A55A5A5A5AULL};
+
+void storeU32(uchar* target, uint32_t value) noexcept
+{
+    for (uint8_t i = 0U; i < 4U; ++i)
+    {
+        target[i] = static_cast<uchar>(value >> (8U * i));
+    }
+}
+
+void storeU64(uchar* target, uint64_t value) noexcept
+{
+    for (uint8_t i = 0U; i < 8U; ++i)
+    {
+        target[i] = static_cast<uchar>(value >> (8U * i));
+    }
+}
+
+uint32_t loadU32(const uchar* source) noexcept
+{
+    uint32_t value {0U};
+    for (uint8_t i = 0U; i < 4U; ++i)
+    {
+        value |= static_cast<uint32_t>(source[i]) << (8U * i);
+    }
+    return value;
+}
+
+uint64_t loadU64(const uchar* source) noexcept
+{
+    uint64_t value {0U};
+    for (uint8_t i = 0U; i < 8U; ++i)
+    {
+        value |= static_cast<uint64_t>(source[i]) << (8U * i);
+    }
+    return value;
+}
+
+uint64_t hashKey(const PositionDatabase::PositionKey& key) noexcept
+{
+    uint64_t hash {0xCBF29CE484222325ULL};
+    for (uint8_t byte : key)
+    {
+        hash = (hash ^ byte) * 0x100000001B3ULL;
+    }
+    return hash ^ (hash >> 29);
+}
+
+// The 8 symmetries of the square as combinations of a row flip, a column flip and a transposition
+uint8_t sourceCell(uint8_t symmetry, uint8_t row, uint8_t col) noexcept
+{
+    constexpr uint8_t Last {PositionDatabase::BoardSize - 1};
+    uint8_t r = (symmetry & 1U) ? Last - row : row;
+    uint8_t c = (symmetry & 2U) ? Last - col : col;
+    return (symmetry & 4U) ? c * PositionDatabase::BoardSize + r : r * PositionDatabase::BoardSize + c;
+}
+
+// Buffers fixed-size records so run and database files are written in large blocks
+class RecordWriter
+{
+public:
+    explicit RecordWriter(QFileDevice& file) : m_file(file)
+    {
+        m_buffer.reserve(WriteBufferBytes);
+    }
+
+    void append(const uchar* data, size_t size)
+    {
+        if (m_buffer.size() + size > WriteBufferBytes)
+        {
+            flush();
+        }
+        m_buffer.insert(m_buffer.end(), data, data + size);
+    }
+
+    void flush()
+    {
+        if (!m_buffer.empty() && m_file.write(reinterpret_cast<const char*>(m_buffer.data()), m_buffer.size()) != static_cast<qint64>(m_buffer.size()))
+        {
+            throw std::runtime_error("Could not write position records");
+        }
+        m_buffer.clear();
+    }
+
+private:
+    QFileDevice& m_file;
+    std::vector<uchar> m_buffer;
+};
+
+}
+
+double PositionOutcome::getMeanScore() const noexcept
+{
+    return visits == 0U ? 0.0 : static_cast<double>(scoreSum) / visits;
+}
+
+PositionDatabase::PositionKey PositionDatabase::canonicalKey(const GameMap& map)
+{
+    if (map.getRowsCount() != BoardSize || map.getColsCount() != BoardSize)
+    {
+        throw std::runtime_error("Position database only stores 9x9 boards");
+    }
+
+    // 0 is an empty tile, colours are 1..7
+    std::array<uint8_t, BoardSize * BoardSize> cells;
+    for (uint8_t row = 0U; row < BoardSize; ++row)
+    {
+        for (uint8_t col = 0U; col < BoardSize; ++col)
+        {
+            bool isOccupied = map.isTileOccupied(row + 1, col + 1);
+            cells[row * BoardSize + col] = isOccupied ? static_cast<uint8_t>(map.getTileContent(row + 1, col + 1)) + 1U : 0U;
+        }
+    }
+
+    // Colours are relabelled in order of first appearance, which maps every colour
+    // permutation of a board to the same sequence; the smallest sequence over all
+    // symmetries is the canonical one
+    std::array<uint8_t, BoardSize * BoardSize> best;
+    std::array<uint8_t, BoardSize * BoardSize> candidate;
+    for (uint8_t symmetry = 0U; symmetry < 8U; ++symmetry)
+    {
+        std::array<uint8_t, 16> labels {};
+        uint8_t nextLabel {1U};
+        for (uint8_t i = 0U; i < BoardSize * BoardSize; ++i)
+        {
+            uint8_t content = cells[sourceCell(symmetry, i / BoardSize, i % BoardSize)];
+            if (content != 0U && labels[content] == 0U)
+            {
+                labels[content] = nextLabel++;
+            }
+            candidate[i] = labels[content];
+        }
+        if (symmetry == 0U || candidate < best)
+        {
+            best = candidate;
+        }
+    }
+
+    // First cell in the high nibble, so byte order of keys is the order of the sequences
+    PositionKey key {};
+    for (uint8_t i = 0U; i < BoardSize * BoardSize; ++i)
+    {
+        key[i / 2] |= (i % 2 == 0U) ? static_cast<uint8_t>(best[i] << 4) : best[i];
+    }
+    return key;
+}
+
+PositionDatabase::PositionDatabase(const QString& directory, uint32_t tableEntriesLog2) : m_directory(directory),
+    m_table(static_cast<size_t>(1U) << tableEntriesLog2), m_tableMask((static_cast<uint64_t>(1U) << tableEntriesLog2) - 1U)
+{
+    if (!QDir().mkpath(m_directory))
+    {
+        throw std::runtime_error("Could not create position database directory");
+    }
+    for (Slot& slot : m_table)
+    {
+        slot.visits = 0U;
+    }
+    while (QFile::exists(getRunPath(m_runsCount)))
+    {
+        ++m_runsCount;
+    }
+    openDatabase();
+}
+
+PositionDatabase::~PositionDatabase()
+{
+    closeDatabase();
+}
+
+QString PositionDatabase::getRunPath(uint32_t run) const
+{
+    return m_directory + QDir::separator() + "run_" + QString::number(run) + ".bin";
+}
+
+QString PositionDatabase::getDatabasePath() const
+{
+    return m_directory + QDir::separator() + "positions.db";
+}
+
+void PositionDatabase::readRecord(const uchar* record, PositionKey& key, PositionOutcome& outcome) noexcept
+{
+    std::memcpy(key.data(), record, KeyBytes);
+    outcome.visits = loadU64(record + KeyBytes);
+    outcome.scoreSum = loadU64(record + KeyBytes + sizeof(uint64_t));
+}
+
+void PositionDatabase::writeRecord(uchar* record, const PositionKey& key, const PositionOutcome& outcome) noexcept
+{
+    std::memcpy(record, key.data(), KeyBytes);
+    storeU64(record + KeyBytes, outcome.visits);
+    storeU64(record + KeyBytes + sizeof(uint64_t), outcome.scoreSum);
+}
+
+void PositionDatabase::openDatabase()
+{
+    m_databaseFile.setFileName(getDatabasePath());
+    if (!m_databaseFile.exists())
+    {
+        return;
+    }
+    if (!m_databaseFile.open(QIODevice::ReadOnly) || m_databaseFile.size() < HeaderBytes)
+    {
+        throw std::runtime_error("Could not open position database");
+    }
+    m_mappedData = m_databaseFile.map(0, m_databaseFile.size());
+    if (!m_mappedData)
+    {
+        throw std::runtime_error("Could not map position database");
+    }
+
+    uint64_t count = loadU64(m_mappedData + 8);
+    if (loadU32(m_mappedData) != DatabaseMagic || loadU32(m_mappedData + 4) != DatabaseVersion ||
+        static_cast<uint64_t>(m_databaseFile.size()) != HeaderBytes + count * RecordBytes)
+    {
+        closeDatabase();
+        throw std::runtime_error("Corrupt position database");
+    }
+    for (uint16_t i = 0U; i < FanoutSize; ++i)
+    {
+        m_fanout[i] = loadU64(m_mappedData + 16 + i * sizeof(uint64_t));
+    }
+    m_records = m_mappedData + HeaderBytes;
+    m_storedCount = count;
+}
+
+void PositionDatabase::closeDatabase()
+{
+    if (m_mappedData)
+    {
+        m_databaseFile.unmap(m_mappedData);
+    }
+    m_databaseFile.close();
+    m_mappedData = nullptr;
+    m_records = nullptr;
+    m_fanout.fill(0U);
+    m_storedCount = 0U;
+}
+
+void PositionDatabase::record(const GameMap& map, uint32_t finalScore)
+{
+    record(canonicalKey(map), 1U, finalScore);
+}
+
+void PositionDatabase::record(const PositionKey& key, uint64_t visits, uint64_t scoreSum)
+{
+    uint64_t index = hashKey(key) & m_tableMask;
+    while (m_table[index].visits != 0U && m_table[index].key != key)
+    {
+        index = (index + 1U) & m_tableMask;
+    }
+
+    Slot& slot = m_table[index];
+    if (slot.visits == 0U)
+    {
+        slot.key = key;
+        slot.scoreSum = 0U;
+        ++m_tableUsed;
+    }
+    slot.visits += visits;
+    slot.scoreSum += scoreSum;
+
+    // Spill at 3/4 load, before linear probing degrades
+    if (m_tableUsed * 4U >= m_table.size() * 3U)
+    {
+        flush();
+    }
+}
+
+void PositionDatabase::flush()
+{
+    if (m_tableUsed == 0U)
+    {
+        return;
+    }
+
+    auto used = std::partition(m_table.begin(), m_table.end(), [](const Slot& slot) { return slot.visits != 0U; });
+    std::sort(m_table.begin(), used, [](const Slot& lhs, const Slot& rhs) { return lhs.key < rhs.key; });
+
+    QFile runFile {getRunPath(m_runsCount)};
+    if (!runFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        throw std::runtime_error("Could not create position run file");
+    }
+    RecordWriter writer {runFile};
+    std::array<uchar, RecordBytes> record;
+    for (auto slot = m_table.begin(); slot != used; ++slot)
+    {
+        writeRecord(record.data(), slot->key, PositionOutcome {slot->visits, slot->scoreSum});
+        writer.append(record.data(), record.size());
+        slot->visits = 0U;
+    }
+    writer.flush();
+    runFile.close();
+
+    ++m_runsCount;
+    m_tableUsed = 0U;
+}
+
+void PositionDatabase::merge()
+{
+    flush();
+    if (m_runsCount == 0U)
+    {
+        return;
+    }
+
+    struct Source
+    {
+        const uchar* records;
+        uint64_t count;
+        uint64_t position;
+    };
+
+    // The current database is just one more sorted input of the k-way merge
+    std::vector<Source> sources;
+    std::vector<std::unique_ptr<QFile>> runFiles;
+    if (m_storedCount != 0U)
+    {
+        sources.push_back(Source {m_records, m_storedCount, 0U});
+    }
+    for (uint32_t run = 0U; run < m_runsCount; ++run)
+    {
+        runFiles.emplace_back(new QFile(getRunPath(run)));
+        QFile& runFile = *runFiles.back();
+        if (!runFile.open(QIODevice::ReadOnly))
+        {
+            throw std::runtime_error("Could not open position run file");
+        }
+        if (runFile.size() == 0)
+        {
+            continue;
+        }
+        const uchar* data = runFile.map(0, runFile.size());
+        if (!data || runFile.size() % RecordBytes != 0)
+        {
+            throw std::runtime_error("Corrupt position run file");
+        }
+        sources.push_back(Source {data, static_cast<uint64_t>(runFile.size()) / RecordBytes, 0U});
+    }
+
+    auto isAfter = [&sources](size_t lhs, size_t rhs)
+    {
+        int order = std::memcmp(sources[lhs].records + sources[lhs].position * RecordBytes,
+                                sources[rhs].records + sources[rhs].position * RecordBytes, KeyBytes);
+        return order > 0 || (order == 0 && lhs > rhs);
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(isAfter)> heap {isAfter};
+    for (size_t i = 0U; i < sources.size(); ++i)
+    {
+        heap.push(i);
+    }
+
+    // Written beside the database and renamed over it in one step once complete
+    QSaveFile mergedFile {getDatabasePath()};
+    if (!mergedFile.open(QIODevice::WriteOnly))
+    {
+        throw std::runtime_error("Could not create position database");
+    }
+    std::array<uchar, HeaderBytes> header {};
+    if (mergedFile.write(reinterpret_cast<const char*>(header.data()), header.size()) != HeaderBytes)
+    {
+        throw std::runtime_error("Could not write position database");
+    }
+
+    RecordWriter writer {mergedFile};
+    std::array<uint64_t, FanoutSize> counts {};
+    std::array<uchar, RecordBytes> record;
+    uint64_t mergedCount {0U};
+    PositionKey currentKey;
+    PositionOutcome current {0U, 0U};
+    auto emitCurrent = [&]()
+    {
+        writeRecord(record.data(), currentKey, current);
+        writer.append(record.data(), record.size());
+        ++counts[currentKey[0]];
+        ++mergedCount;
+    };
+
+    while (!heap.empty())
+    {
+        size_t index = heap.top();
+        heap.pop();
+        Source& source = sources[index];
+
+        PositionKey key;
+        PositionOutcome outcome;
+        readRecord(source.records + source.position * RecordBytes, key, outcome);
+        if (current.visits != 0U && key == currentKey)
+        {
+            current.visits += outcome.visits;
+            current.scoreSum += outcome.scoreSum;
+        }
+        else
+        {
+            if (current.visits != 0U)
+            {
+                emitCurrent();
+            }
+            currentKey = key;
+            current = outcome;
+        }
+
+        if (++source.position < source.count)
+        {
+            heap.push(index);
+        }
+    }
+    if (current.visits != 0U)
+    {
+        emitCurrent();
+    }
+    writer.flush();
+
+    storeU32(header.data(), DatabaseMagic);
+    storeU32(header.data() + 4, DatabaseVersion);
+    storeU64(header.data() + 8, mergedCount);
+    uint64_t cumulative {0U};
+    for (uint16_t i = 0U; i < FanoutSize; ++i)
+    {
+        cumulative += counts[i];
+        storeU64(header.data() + 16 + i * sizeof(uint64_t), cumulative);
+    }
+    if (!mergedFile.seek(0) || mergedFile.write(reinterpret_cast<const char*>(header.data()), header.size()) != HeaderBytes)
+    {
+        throw std::runtime_error("Could not write position database");
+    }
+
+    runFiles.clear();
+    closeDatabase();
+    if (!mergedFile.commit())
+    {
+        throw std::runtime_error("Could not replace position database");
+    }
+    for (uint32_t run = 0U; run < m_runsCount; ++run)
+    {
+        QFile::remove(getRunPath(run));
+    }
+    m_runsCount = 0U;
+    openDatabase();
+}
+
+bool PositionDatabase::lookup(const GameMap& map, PositionOutcome& outcome) const
+{
+    return lookup(canonicalKey(map), outcome);
+}
+
+bool PositionDatabase::lookup(const PositionKey& key, PositionOutcome& outcome) const
+{
+    if (m_storedCount == 0U)
+    {
+        return false;
+    }
+
+    // The fanout narrows the search to the keys sharing the first byte
+    uint64_t low = key[0] == 0U ? 0U : m_fanout[key[0] - 1];
+    uint64_t high = m_fanout[key[0]];
+    while (low < high)
+    {
+        uint64_t middle = low + (high - low) / 2U;
+        int order = std::memcmp(m_records + middle * RecordBytes, key.data(), KeyBytes);
+        if (order == 0)
+        {
+            PositionKey storedKey;
+            readRecord(m_records + middle * RecordBytes, storedKey, outcome);
+            return true;
+        }
+        if (order < 0)
+        {
+            low = middle + 1U;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return false;
+}
+
+uint64_t PositionDatabase::getStoredCount() const noexcept
+{
+    return m_storedCount;
+}
+
+uint32_t PositionDatabase::getRunsCount() const noexcept
+{
+    return m_runsCount;
+}
+
+int runPositionIndexer(const QString& directory, uint32_t games, uint64_t baseSeed, ColoursUsed colours)
+{
+    QTextStream out(stdout);
+    QElapsedTimer timer;
+    timer.start();
+
+    PositionDatabase database {directory, 18U};
+    Game game;
+    GreedyPlayer player;
+    std::vector<PositionDatabase::PositionKey> visited;
+    uint64_t recorded {0U};
+    for (uint32_t i = 0U; i < games; ++i)
+    {
+        uint64_t seed = baseSeed + i;
+        game.start(colours, seed);
+        Rng rng {seed ^ PlayerSeedSalt};
+        Move move;
+        visited.clear();
+        visited.push_back(PositionDatabase::canonicalKey(game.getMap()));
+        while (!game.isGameOver() && player.chooseMove(game.getMap(), rng, move) &&
+               game.moveBall(move.fromRow, move.fromCol, move.destRow, move.destCol))
+        {
+            visited.push_back(PositionDatabase::canonicalKey(game.getMap()));
+        }
+        // Outcomes are only known at the end, so the game's positions are recorded then
+        for (auto&& key : visited)
+        {
+            database.record(key, 1U, game.getScore());
+        }
+        recorded += visited.size();
+    }
+
+    database.merge();
+
+    PositionOutcome mostVisited {0U, 0U};
+    database.forEachStored([&](const PositionDatabase::PositionKey&, const PositionOutcome& outcome)
+    {
+        if (outcome.visits > mostVisited.visits)
+        {
+            mostVisited = outcome;
+        }
+    });
+
+    out << "Recorded " << recorded << " positions from " << games << " games in " << timer.elapsed() << " ms" << endl;
+    out << "Database holds " << database.getStoredCount() << " distinct positions" << endl;
+    if (mostVisited.visits != 0U)
+    {
+        out << "Most visited position: " << mostVisited.visits << " visits, mean final score " << mostVisited.getMeanScore() << endl;
+    }
+    return 0;
+}
+
+}
@@ -0,0 +1,102 @@
+#ifndef POSITIONDATABASE_H
+#define POSITIONDATABASE_H
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <QFile>
+#include <QString>
+
+#include "gamemap.h"
+
+namespace Qoolkie
+{
+
+struct PositionOutcome
+{
+    uint64_t visits;
+    uint64_t scoreSum;
+
+    double getMeanScore() const noexcept;
+};
+
+// Stores distinct 9x9 positions with the outcomes of the games that went through them.
+// Positions are reduced to a canonical form under the 8 board symmetries and any
+// permutation of colours, then packed at 4 bits per cell. New records collect in an
+// open-addressing table that is spilled as a sorted run file whenever it fills up;
+// merge() folds all runs into the database file, which is memory-mapped for lookups.
+// Only merged records are visible to lookup().
+class PositionDatabase
+{
+public:
+    static constexpr uint8_t BoardSize {GameMap::Rules::BoardSize};
+    static constexpr uint8_t KeyBytes {(BoardSize * BoardSize + 1) / 2};
+    using PositionKey = std::array<uint8_t, KeyBytes>;
+
+    static PositionKey canonicalKey(const GameMap& map);
+
+    PositionDatabase(const QString& directory, uint32_t tableEntriesLog2);
+    ~PositionDatabase();
+    PositionDatabase(const PositionDatabase&) = delete;
+    PositionDatabase& operator=(const PositionDatabase&) = delete;
+
+    void record(const GameMap& map, uint32_t finalScore);
+    void record(const PositionKey& key, uint64_t visits, uint64_t scoreSum);
+    void flush();
+    void merge();
+
+    bool lookup(const GameMap& map, PositionOutcome& outcome) const;
+    bool lookup(const PositionKey& key, PositionOutcome& outcome) const;
+    uint64_t getStoredCount() const noexcept;
+    uint32_t getRunsCount() const noexcept;
+
+    template<typename Function>
+    void forEachStored(Function function) const
+    {
+        for (uint64_t i = 0U; i < m_storedCount; ++i)
+        {
+            PositionKey key;
+            PositionOutcome outcome;
+            readRecord(m_records + i * RecordBytes, key, outcome);
+            function(key, outcome);
+        }
+    }
+
+private:
+    static constexpr uint8_t RecordBytes {KeyBytes + 2 * sizeof(uint64_t)};
+    static constexpr uint16_t FanoutSize {256};
+    static constexpr uint32_t HeaderBytes {16U + FanoutSize * sizeof(uint64_t)};
+
+    struct Slot
+    {
+        PositionKey key;
+        uint64_t visits;
+        uint64_t scoreSum;
+    };
+
+    static void readRecord(const uchar* record, PositionKey& key, PositionOutcome& outcome) noexcept;
+    static void writeRecord(uchar* record, const PositionKey& key, const PositionOutcome& outcome) noexcept;
+
+    QString getRunPath(uint32_t run) const;
+    QString getDatabasePath() const;
+    void openDatabase();
+    void closeDatabase();
+
+    QString m_directory;
+    std::vector<Slot> m_table;
+    uint64_t m_tableMask;
+    uint64_t m_tableUsed {0U};
+    uint32_t m_runsCount {0U};
+
+    QFile m_databaseFile;
+    uchar* m_mappedData {nullptr};
+    const uchar* m_records {nullptr};
+    std::array<uint64_t, FanoutSize> m_fanout {};
+    uint64_t m_storedCount {0U};
+};
+
+int runPositionIndexer(const QString& directory, uint32_t games, uint64_t baseSeed, ColoursUsed colours);
+
+}
+
+#endif
@@ -0,0 +1,104 @@
+#include "protocol.h"
+
+namespace Qoolkie
+{
+
+namespace Protocol
+{
+
+namespace
+{
+
+QByteArray frame(const QByteArray& payload)
+{
+    QByteArray data;
+    data.reserve(FrameHeaderSize + payload.size());
+    data.append(static_cast<char>(payload.size() & 0xFF));
+    data.append(static_cast<char>((payload.size() >> 8) & 0xFF));
+    data.append(payload);
+    return data;
+}
+
+}
+
+QByteArray encodeNewGame(ColoursUsed colours)
+{
+    QByteArray payload;
+    payload.append(static_cast<char>(MessageType::NewGame));
+    payload.append(static_cast<char>(colours));
+    return frame(payload);
+}
+
+QByteArray encodeMove(uint8_t fromRow, uint8_t fromCol, uint8_t destRow, uint8_t destCol)
+{
+    QByteArray payload;
+    payload.append(static_cast<char>(MessageType::Move));
+    payload.append(static_cast<char>(fromRow));
+    payload.append(static_cast<char>(fromCol));
+    payload.append(static_cast<char>(destRow));
+    payload.append(static_cast<char>(destCol));
+    return frame(payload);
+}
+
+QByteArray encodeTurnDiff(const TurnDiff& diff)
+{
+    QByteArray payload;
+    payload.reserve(7 + 2 * static_cast<int>(diff.tiles.size()));
+    payload.append(static_cast<char>(MessageType::TurnDiff));
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        payload.append(static_cast<char>((diff.score >> shift) & 0xFF));
+    }
+    payload.append(static_cast<char>(diff.flags));
+    payload.append(static_cast<char>(diff.tiles.size()));
+    for (auto&& tile : diff.tiles)
+    {
+        payload.append(static_cast<char>(tile.first));
+        payload.append(static_cast<char>(tile.second));
+    }
+    return frame(payload);
+}
+
+bool decodeTurnDiff(const QByteArray& payload, TurnDiff& diff)
+{
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(payload.constData());
+    if (payload.size() < 7 || data[0] != static_cast<uint8_t>(MessageType::TurnDiff))
+    {
+        return false;
+    }
+    uint8_t count = data[6];
+    if (payload.size() != 7 + 2 * count)
+    {
+        return false;
+    }
+
+    diff.score = data[1] | (data[2] << 8) | (data[3] << 16) | (static_cast<uint32_t>(data[4]) << 24);
+    diff.flags = data[5];
+    diff.tiles.clear();
+    for (uint8_t i = 0U; i < count; ++i)
+    {
+        diff.tiles.push_back(std::make_pair(data[7 + 2 * i], static_cast<TileContent>(data[8 + 2 * i])));
+    }
+    return true;
+}
+
+bool takeFrame(QByteArray& buffer, QByteArray& payload)
+{
+    if (buffer.size() < FrameHeaderSize)
+    {
+        return false;
+    }
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(buffer.constData());
+    int length = data[0] | (data[1] << 8);
+    if (buffer.size() < FrameHeaderSize + length)
+    {
+        return false;
+    }
+    payload = buffer.mid(FrameHeaderSize, length);
+    buffer.remove(0, FrameHeaderSize + length);
+    return true;
+}
+
+}
+
+}
@@ -0,0 +1,58 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cstdint>
+#include <vector>
+#include <QByteArray>
+
+#include "gamemap.h"
+
+namespace Qoolkie
+{
+
+// Wire format of the headless server. Every frame is a little-endian uint16 payload
+// length followed by the payload; the first payload byte is the message type.
+//   NewGame   client -> server  [type][colours]
+//   Move      client -> server  [type][fromRow][fromCol][destRow][destCol]
+//   TurnDiff  server -> client  [type][score:u32][flags][count]{[cell][content]}*count
+// Cells are 0-based row * 9 + col indices, a cleared tile is sent as TileContent::None.
+namespace Protocol
+{
+
+enum class MessageType : uint8_t
+{
+    NewGame = 0x01,
+    Move = 0x02,
+    TurnDiff = 0x81
+};
+
+enum TurnFlags : uint8_t
+{
+    GameOverFlag = 0x01,
+    MoveRejectedFlag = 0x02,
+    BoardResetFlag = 0x04
+};
+
+struct TurnDiff
+{
+    uint32_t score {0U};
+    uint8_t flags {0U};
+    std::vector<std::pair<uint8_t, TileContent>> tiles;
+};
+
+constexpr uint8_t BoardCols {GameMap::Rules::BoardSize};
+constexpr int FrameHeaderSize {2};
+
+QByteArray encodeNewGame(ColoursUsed colours);
+QByteArray encodeMove(uint8_t fromRow, uint8_t fromCol, uint8_t destRow, uint8_t destCol);
+QByteArray encodeTurnDiff(const TurnDiff& diff);
+bool decodeTurnDiff(const QByteArray& payload, TurnDiff& diff);
+
+// Removes one complete frame from the front of buffer, returns false until one is available
+bool takeFrame(QByteArray& buffer, QByteArray& payload);
+
+}
+
+}
+
+#endif
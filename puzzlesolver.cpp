@@ -0,0 +1,359 @@
+#include "puzzlesolver.h"
+
+#include <algorithm>
+#include <array>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+
+namespace Qoolkie
+{
+
+constexpr uint8_t PuzzleSolver::Unsolved;
+
+namespace
+{
+
+constexpr uint8_t Found {0xFE};
+using Rules = GamePool::Rules;
+
+constexpr uint8_t MaxGainMultiplier {Rules::Gains::Multipliers[Rules::Gains::Count - 1U]};
+constexpr uint8_t NewTilesNb {Rules::SpawnsPerTurn};
+constexpr uint8_t MinBallsInLine {Rules::LineLength};
+
+struct BoardCounts
+{
+    uint8_t balls {0U};
+    uint8_t distinctColours {0U};
+    uint8_t maxPerColour {0U};
+};
+
+// Most balls of a single colour inside any MinBallsInLine window, in any of the four directions
+uint8_t bestWindowFill(const GamePool& pool, SessionHandle node)
+{
+    static constexpr int8_t Directions[4][2] { {0, 1}, {1, 1}, {1, 0}, {1, -1} };
+
+    std::array<TileContent, GamePool::CellsPerBoard> tiles;
+    for (uint8_t i = 0U; i < GamePool::BoardRows; ++i)
+    {
+        for (uint8_t j = 0U; j < GamePool::BoardCols; ++j)
+        {
+            tiles[i * GamePool::BoardCols + j] = pool.getTileContent(node, i, j);
+        }
+    }
+
+    uint8_t best {0U};
+    for (auto&& direction : Directions)
+    {
+        for (int row = 0; row < GamePool::BoardRows; ++row)
+        {
+            for (int col = 0; col < GamePool::BoardCols; ++col)
+            {
+                int lastRow = row + direction[0] * (MinBallsInLine - 1);
+                int lastCol = col + direction[1] * (MinBallsInLine - 1);
+                if (lastRow >= GamePool::BoardRows || lastCol < 0 || lastCol >= GamePool::BoardCols)
+                {
+                    continue;
+                }
+                std::array<uint8_t, static_cast<size_t>(TileContent::Wall)> perColour {};
+                for (uint8_t k = 0U; k < MinBallsInLine; ++k)
+                {
+                    TileContent content = tiles[(row + direction[0] * k) * GamePool::BoardCols + col + direction[1] * k];
+                    if (content < TileContent::Wall)
+                    {
+                        best = std::max<uint8_t>(best, ++perColour[static_cast<size_t>(content)]);
+                    }
+                }
+            }
+        }
+    }
+    return best;
+}
+
+BoardCounts countBalls(const GamePool& pool, SessionHandle node)
+{
+    std::array<uint8_t, static_cast<size_t>(TileContent::Wall)> perColour {};
+    BoardCounts counts;
+    for (uint8_t i = 0U; i < GamePool::BoardRows; ++i)
+    {
+        for (uint8_t j = 0U; j < GamePool::BoardCols; ++j)
+        {
+            TileContent content = pool.getTileContent(node, i, j);
+            if (content < TileContent::Wall)
+            {
+                uint8_t& count = perColour[static_cast<size_t>(content)];
+                counts.distinctColours += (count == 0U) ? 1U : 0U;
+                ++count;
+                ++counts.balls;
+                counts.maxPerColour = std::max(counts.maxPerColour, count);
+            }
+        }
+    }
+    return counts;
+}
+
+bool isSolved(const GamePool& pool, SessionHandle node, PuzzleGoal goal, uint32_t targetScore)
+{
+    if (goal == PuzzleGoal::ReachScore)
+    {
+        return pool.getScore(node) >= targetScore;
+    }
+    return countBalls(pool, node).balls == 0U;
+}
+
+TileContent parseTile(QChar symbol)
+{
+    switch (symbol.toLatin1())
+    {
+        case 'k':
+            return TileContent::Black;
+        case 'b':
+            return TileContent::Blue;
+        case 'g':
+            return TileContent::Green;
+        case 'p':
+            return TileContent::Pink;
+        case 'u':
+            return TileContent::Purple;
+        case 'r':
+            return TileContent::Red;
+        case 'y':
+            return TileContent::Yellow;
+        default:
+            return TileContent::None;
+    }
+}
+
+}
+
+PuzzleSolver::PuzzleSolver(uint8_t maxDepth, uint32_t cacheEntriesLog2) : m_maxDepth(std::min<uint8_t>(maxDepth, 0xF0)),
+                                                                         m_pool(m_maxDepth + 1U),
+                                                                         m_moves(m_maxDepth + 1U),
+                                                                         m_cache(static_cast<size_t>(1U) << cacheEntriesLog2),
+                                                                         m_cacheMask((static_cast<uint64_t>(1U) << cacheEntriesLog2) - 1U)
+{
+    for (uint8_t i = 0U; i <= m_maxDepth; ++i)
+    {
+        m_nodes.push_back(m_pool.acquire(ColoursUsed::Five, 0U));
+    }
+}
+
+uint64_t PuzzleSolver::getExpandedNodes() const noexcept
+{
+    return m_expandedNodes;
+}
+
+bool PuzzleSolver::isSolved(SessionHandle node) const
+{
+    return Qoolkie::isSolved(m_pool, node, m_goal, m_targetScore);
+}
+
+uint8_t PuzzleSolver::estimate(SessionHandle node) const
+{
+    // Admissible bounds: a move clears at most one line through the moved ball, or up to
+    // NewTilesNb lines through the spawned balls, no line can form at all while every
+    // colour has at most one ball on the board, and a window gains at most the moved
+    // ball plus the spawned ones per move
+    BoardCounts counts = countBalls(m_pool, node);
+    uint8_t idleMove = (counts.maxPerColour <= 1U) ? 1U : 0U;
+    if (m_goal == PuzzleGoal::ReachScore)
+    {
+        uint32_t score = m_pool.getScore(node);
+        if (score >= m_targetScore)
+        {
+            return 0U;
+        }
+        uint32_t maxGainPerMove = NewTilesNb * MaxGainMultiplier * static_cast<uint8_t>(m_pool.getColours(node));
+        uint32_t moves = (m_targetScore - score + maxGainPerMove - 1U) / maxGainPerMove;
+        uint32_t missing = MinBallsInLine - std::min(bestWindowFill(m_pool, node), MinBallsInLine);
+        uint32_t lineMoves = (missing + NewTilesNb) / (NewTilesNb + 1U);
+        return static_cast<uint8_t>(std::min<uint32_t>(std::max(moves + idleMove, lineMoves), Found - 1U));
+    }
+    if (counts.balls == 0U)
+    {
+        return 0U;
+    }
+    return static_cast<uint8_t>((counts.distinctColours + NewTilesNb - 1U) / NewTilesNb + idleMove);
+}
+
+void PuzzleSolver::orderMoves(uint8_t depth)
+{
+    // Moves completing a line first, then the ones growing the longest line
+    std::vector<Move>& moves = m_moves[depth];
+    std::vector<std::pair<size_t, size_t>> keys;
+    keys.reserve(moves.size());
+    for (size_t i = 0U; i < moves.size(); ++i)
+    {
+        const Move& move = moves[i];
+        TileContent content = m_map.getTileContent(move.fromRow + 1, move.fromCol + 1);
+        m_map.setTileContent(move.fromRow + 1, move.fromCol + 1, TileContent::None);
+        m_map.setTileContent(move.destRow + 1, move.destCol + 1, content);
+        keys.push_back(std::make_pair(m_map.checkForScore(move.destRow + 1, move.destCol + 1, content).size(), i));
+        m_map.setTileContent(move.destRow + 1, move.destCol + 1, TileContent::None);
+        m_map.setTileContent(move.fromRow + 1, move.fromCol + 1, content);
+    }
+    std::stable_sort(keys.begin(), keys.end(), [](const std::pair<size_t, size_t>& left, const std::pair<size_t, size_t>& right)
+    {
+        return left.first > right.first;
+    });
+
+    std::vector<Move> ordered;
+    ordered.reserve(moves.size());
+    for (auto&& key : keys)
+    {
+        ordered.push_back(moves[key.second]);
+    }
+    moves.swap(ordered);
+}
+
+uint8_t PuzzleSolver::search(uint8_t depth, uint8_t threshold, std::vector<Move>& solution)
+{
+    SessionHandle node = m_nodes[depth];
+    uint32_t f = depth + estimate(node);
+    if (f > threshold)
+    {
+        return f > m_maxDepth ? Unsolved : static_cast<uint8_t>(f);
+    }
+    if (isSolved(node))
+    {
+        solution.resize(depth);
+        return Found;
+    }
+    if (depth == m_maxDepth || m_pool.isGameOver(node))
+    {
+        return Unsolved;
+    }
+
+    uint8_t budget = threshold - depth;
+    uint64_t key = m_pool.hashSession(node);
+    CacheEntry& entry = m_cache[key & m_cacheMask];
+    if (entry.key == key && entry.budget >= budget)
+    {
+        // Already searched with at least this budget, nothing cheaper than its old frontier exists below
+        return entry.excess == Unsolved ? Unsolved : static_cast<uint8_t>(depth + entry.excess);
+    }
+
+    ++m_expandedNodes;
+    m_pool.loadMap(node, m_map);
+    collectLegalMoves(m_map, m_moves[depth]);
+    orderMoves(depth);
+
+    uint8_t next = Unsolved;
+    SessionHandle child = m_nodes[depth + 1];
+    for (size_t i = 0U; i < m_moves[depth].size(); ++i)
+    {
+        const Move move = m_moves[depth][i];
+        m_pool.copySession(node, child);
+        m_pool.move(child, move.fromRow, move.fromCol, move.destRow, move.destCol);
+
+        uint8_t result = search(depth + 1, threshold, solution);
+        if (result == Found)
+        {
+            solution[depth] = move;
+            return Found;
+        }
+        next = std::min(next, result);
+    }
+
+    m_cache[key & m_cacheMask] = CacheEntry {key, budget, next == Unsolved ? Unsolved : static_cast<uint8_t>(next - depth)};
+    return next;
+}
+
+bool PuzzleSolver::solve(const GamePool& pool, SessionHandle start, PuzzleGoal goal, uint32_t targetScore, std::vector<Move>& solution)
+{
+    m_goal = goal;
+    m_targetScore = targetScore;
+    m_expandedNodes = 0U;
+    std::fill(m_cache.begin(), m_cache.end(), CacheEntry {0U, 0U, 0U});
+    m_pool.copySession(pool, start, m_nodes[0]);
+
+    uint8_t threshold = estimate(m_nodes[0]);
+    while (threshold <= m_maxDepth)
+    {
+        uint8_t result = search(0U, threshold, solution);
+        if (result == Found)
+        {
+            return true;
+        }
+        if (result == Unsolved)
+        {
+            return false;
+        }
+        threshold = result;
+    }
+    return false;
+}
+
+bool PuzzleSolver::verify(const GamePool& pool, SessionHandle start, PuzzleGoal goal, uint32_t targetScore, const std::vector<Move>& solution)
+{
+    GamePool replay {1U};
+    SessionHandle node = replay.acquire(ColoursUsed::Five, 0U);
+    replay.copySession(pool, start, node);
+    for (auto&& move : solution)
+    {
+        if (!replay.move(node, move.fromRow, move.fromCol, move.destRow, move.destCol).isLegal)
+        {
+            return false;
+        }
+    }
+    return Qoolkie::isSolved(replay, node, goal, targetScore);
+}
+
+int runSolver(const QString& puzzlePath, uint64_t seed, ColoursUsed colours, uint32_t targetScore, uint8_t maxDepth)
+{
+    QTextStream out(stdout);
+    GamePool pool {1U};
+    SessionHandle start = pool.acquire(colours, seed);
+
+    if (!puzzlePath.isEmpty())
+    {
+        // Nine rows of nine tiles: '.' is empty, k b g p u r y are the colours
+        QFile puzzleFile(puzzlePath);
+        if (!puzzleFile.open(QIODevice::ReadOnly))
+        {
+            out << "Could not open " << puzzlePath << endl;
+            return 1;
+        }
+        QTextStream in(&puzzleFile);
+        uint8_t row {0U};
+        while (!in.atEnd() && row < GamePool::BoardRows)
+        {
+            QString line = in.readLine().trimmed();
+            if (line.isEmpty() || line.startsWith("#"))
+            {
+                continue;
+            }
+            for (uint8_t col = 0U; col < GamePool::BoardCols; ++col)
+            {
+                pool.setTileContent(start, row, col, col < line.size() ? parseTile(line.at(col)) : TileContent::None);
+            }
+            ++row;
+        }
+        pool.reseed(start, seed);
+    }
+
+    PuzzleGoal goal = targetScore > 0U ? PuzzleGoal::ReachScore : PuzzleGoal::ClearBoard;
+    PuzzleSolver solver {maxDepth, 20U};
+    std::vector<Move> solution;
+    QElapsedTimer timer;
+    timer.start();
+    bool isSolved = solver.solve(pool, start, goal, targetScore, solution);
+    qint64 elapsed = timer.elapsed();
+
+    if (!isSolved)
+    {
+        out << "No solution within " << maxDepth << " moves (" << solver.getExpandedNodes() << " nodes, " << elapsed << " ms)" << endl;
+        return 1;
+    }
+    out << "Solved in " << static_cast<unsigned>(solution.size()) << " moves (" << solver.getExpandedNodes() << " nodes, " << elapsed << " ms)" << endl;
+    for (auto&& move : solution)
+    {
+        out << static_cast<unsigned>(move.fromRow) << ',' << static_cast<unsigned>(move.fromCol) << " -> "
+            << static_cast<unsigned>(move.destRow) << ',' << static_cast<unsigned>(move.destCol) << endl;
+    }
+    bool isVerified = solver.verify(pool, start, goal, targetScore, solution);
+    out << "verified: " << (isVerified ? "yes" : "no") << endl;
+    return isVerified ? 0 : 1;
+}
+
+}
@@ -0,0 +1,66 @@
+#ifndef PUZZLESOLVER_H
+#define PUZZLESOLVER_H
+
+#include <cstdint>
+#include <vector>
+#include <QString>
+
+#include "gamepool.h"
+#include "player.h"
+
+namespace Qoolkie
+{
+
+enum class PuzzleGoal : uint8_t
+{
+    ClearBoard,
+    ReachScore
+};
+
+// Finds a shortest move sequence for a position whose spawn stream is fixed by the
+// session's RNG state, using iterative-deepening A*. Every node is a GamePool slot,
+// so moves follow exactly the rules of GamePool::move. Visited states are kept in a
+// fixed-size transposition table that remembers how much search budget was already
+// spent below them.
+class PuzzleSolver
+{
+public:
+    PuzzleSolver(uint8_t maxDepth, uint32_t cacheEntriesLog2);
+
+    bool solve(const GamePool& pool, SessionHandle start, PuzzleGoal goal, uint32_t targetScore, std::vector<Move>& solution);
+    bool verify(const GamePool& pool, SessionHandle start, PuzzleGoal goal, uint32_t targetScore, const std::vector<Move>& solution);
+    uint64_t getExpandedNodes() const noexcept;
+
+private:
+    struct CacheEntry
+    {
+        uint64_t key;
+        uint8_t budget;
+        uint8_t excess;
+    };
+
+    static constexpr uint8_t Unsolved {0xFF};
+
+    bool isSolved(SessionHandle node) const;
+    uint8_t estimate(SessionHandle node) const;
+    uint8_t search(uint8_t depth, uint8_t threshold, std::vector<Move>& solution);
+    void orderMoves(uint8_t depth);
+
+    uint8_t m_maxDepth;
+    GamePool m_pool;
+    std::vector<SessionHandle> m_nodes;
+    std::vector<std::vector<Move>> m_moves;
+    std::vector<CacheEntry> m_cache;
+    uint64_t m_cacheMask;
+    GameMap m_map;
+
+    PuzzleGoal m_goal {PuzzleGoal::ClearBoard};
+    uint32_t m_targetScore {0U};
+    uint64_t m_expandedNodes {0U};
+};
+
+int runSolver(const QString& puzzlePath, uint64_t seed, ColoursUsed colours, uint32_t targetScore, uint8_t maxDepth);
+
+}
+
+#endif
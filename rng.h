@@ -0,0 +1,57 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+
+namespace Qoolkie
+{
+
+// Small xorshift64* generator. The whole stream is described by one 64-bit word,
+// so sessions can be stored, copied and replayed without touching std::rand().
+class Rng
+{
+public:
+    explicit Rng(uint64_t seed = 0U) noexcept : m_state(scramble(seed))
+    {
+    }
+
+    uint64_t next() noexcept
+    {
+        m_state ^= m_state >> 12;
+        m_state ^= m_state << 25;
+        m_state ^= m_state >> 27;
+        return m_state * 0x2545F4914F6CDD1DULL;
+    }
+
+    uint32_t nextBelow(uint32_t bound) noexcept
+    {
+        return static_cast<uint32_t>((next() >> 32) % bound);
+    }
+
+    uint64_t getState() const noexcept
+    {
+        return m_state;
+    }
+
+    void setState(uint64_t state) noexcept
+    {
+        m_state = state;
+    }
+
+private:
+    static uint64_t scramble(uint64_t seed) noexcept
+    {
+        // splitmix64 step, never yields the all-zero state xorshift cannot leave
+        uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        z ^= z >> 31;
+        return z != 0U ? z : 0x9E3779B97F4A7C15ULL;
+    }
+
+    uint64_t m_state;
+};
+
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <array>
+
+namespace Qoolkie
+{
+
+// Multipliers of the base gain by how many balls a line has beyond LineLength; longer
+// lines use the last entry
+template<uint8_t... MultiplierValues>
+struct GainTable
+{
+    static constexpr uint8_t Count {sizeof...(MultiplierValues)};
+    static constexpr uint8_t Multipliers[] {MultiplierValues...};
+
+    static_assert(Count >= 1U, "A gain table needs at least one multiplier");
+};
+
+template<uint8_t... M> constexpr uint8_t GainTable<M...>::Count;
+template<uint8_t... M> constexpr uint8_t GainTable<M...>::Multipliers[];
+
+using ClassicGains = GainTable<1, 2, 3, 4>;
+
+// Compile-time description of a game variant. Everything that depends on the rules
+// reads them from here, so a variant is a new instantiation rather than runtime checks.
+template<uint8_t BoardSizeValue, uint8_t LineLengthValue, uint8_t SpawnsPerTurnValue, uint8_t ColoursCountValue,
+         typename GainsPolicy = ClassicGains>
+struct Rules
+{
+    static constexpr uint8_t BoardSize {BoardSizeValue};
+    static constexpr uint8_t LineLength {LineLengthValue};
+    static constexpr uint8_t SpawnsPerTurn {SpawnsPerTurnValue};
+    // Most colours a game of this variant may use
+    static constexpr uint8_t ColoursCount {ColoursCountValue};
+    using Gains = GainsPolicy;
+
+    static_assert(LineLength >= 2U && LineLength <= BoardSize, "A line has to fit on the board");
+    static_assert(ColoursCount >= 1U && ColoursCount <= 7U, "Only seven ball colours exist");
+
+    static constexpr bool isScoringLine(size_t ballsInLine) noexcept
+    {
+        return ballsInLine >= LineLength;
+    }
+
+    // Only meaningful for scoring lines
+    static constexpr uint16_t calculateGain(uint16_t baseGain, size_t ballsInLine) noexcept
+    {
+        return baseGain * Gains::Multipliers[ballsInLine - LineLength < Gains::Count ? ballsInLine - LineLength : Gains::Count - 1U];
+    }
+};
+
+template<uint8_t B, uint8_t L, uint8_t S, uint8_t C, typename G> constexpr uint8_t Rules<B, L, S, C, G>::BoardSize;
+template<uint8_t B, uint8_t L, uint8_t S, uint8_t C, typename G> constexpr uint8_t Rules<B, L, S, C, G>::LineLength;
+template<uint8_t B, uint8_t L, uint8_t S, uint8_t C, typename G> constexpr uint8_t Rules<B, L, S, C, G>::SpawnsPerTurn;
+template<uint8_t B, uint8_t L, uint8_t S, uint8_t C, typename G> constexpr uint8_t Rules<B, L, S, C, G>::ColoursCount;
+
+// 9x9 board, lines of five, three balls per turn, up to seven colours
+using ClassicRules = Rules<9, 5, 3, 7, ClassicGains>;
+
+}
+
+#endif
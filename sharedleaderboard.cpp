@@ -0,0 +1,424 @@
+#include "sharedleaderboard.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <QDir>
+#include <QtGlobal>
+
+#ifdef Q_OS_LINUX
+#include <atomic>
+#include <cerrno>
+#include <new>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#endif
+
+namespace Qoolkie
+{
+
+constexpr uint8_t SharedLeaderboard::Capacity;
+constexpr uint8_t SharedLeaderboard::NameBytes;
+
+namespace
+{
+
+constexpr char LeaderboardFileName[] = "qoolkie_leaderboard.bin";
+constexpr char highscores5FileName[] = "highscores_5.json";
+constexpr char highscores7FileName[] = "highscores_7.json";
+
+const char* getHighscoresFileName(ColoursUsed colours) noexcept
+{
+    return colours == ColoursUsed::Five ? highscores5FileName : highscores7FileName;
+}
+
+}
+
+QString SharedLeaderboard::getDefaultPath()
+{
+    return QDir::homePath() + QDir::separator() + LeaderboardFileName;
+}
+
+#ifdef Q_OS_LINUX
+
+namespace
+{
+
+constexpr uint32_t LeaderboardMagic {0x44424C51}; // "QLBD"
+constexpr uint32_t LeaderboardVersion {1U};
+constexpr uint8_t ModesCount {2U};
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "Shared tables need address-free atomics");
+
+struct SharedEntry
+{
+    char name[SharedLeaderboard::NameBytes];
+    uint64_t score;
+};
+
+// Odd sequence while a writer fills the table
+struct SharedTable
+{
+    std::atomic<uint32_t> sequence;
+    uint32_t count;
+    uint64_t checksum;
+    SharedEntry entries[SharedLeaderboard::Capacity];
+};
+
+// Readers use tables[published]; a writer only ever fills the other one
+struct SharedMode
+{
+    std::atomic<uint32_t> published;
+    uint32_t reserved;
+    SharedTable tables[2];
+};
+
+uint8_t getModeIdx(ColoursUsed colours) noexcept
+{
+    return colours == ColoursUsed::Five ? 0U : 1U;
+}
+
+uint64_t calculateChecksum(const SharedTable& table) noexcept
+{
+    uint64_t hash {0xCBF29CE484222325ULL ^ table.count};
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(table.entries);
+    for (size_t i = 0U; i < sizeof(table.entries); ++i)
+    {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+bool isTableValid(const SharedTable& table) noexcept
+{
+    return table.count <= SharedLeaderboard::Capacity && table.checksum == calculateChecksum(table);
+}
+
+// False if a writer was filling the table while it was being copied
+bool copyTable(const SharedTable& table, SharedTable& copy) noexcept
+{
+    uint32_t sequence = table.sequence.load(std::memory_order_acquire);
+    if ((sequence & 1U) != 0U)
+    {
+        return false;
+    }
+    copy.count = table.count;
+    copy.checksum = table.checksum;
+    std::memcpy(static_cast<void*>(copy.entries), table.entries, sizeof(copy.entries));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return table.sequence.load(std::memory_order_relaxed) == sequence;
+}
+
+void copyPublishedTable(const SharedMode& mode, SharedTable& copy) noexcept
+{
+    // Only retried if two inserts complete while this copy is being taken
+    while (!copyTable(mode.tables[mode.published.load(std::memory_order_acquire) & 1U], copy))
+    {
+    }
+}
+
+std::vector<std::pair<std::string, uint64_t>> getHighscores(const SharedTable& table)
+{
+    uint32_t count = std::min<uint32_t>(table.count, SharedLeaderboard::Capacity);
+    std::vector<std::pair<std::string, uint64_t>> highscores;
+    highscores.reserve(count);
+    for (uint32_t i = 0U; i < count; ++i)
+    {
+        const SharedEntry& entry = table.entries[i];
+        highscores.push_back(std::make_pair(std::string(entry.name, strnlen(entry.name, SharedLeaderboard::NameBytes)),
+                                            entry.score));
+    }
+    return highscores;
+}
+
+}
+
+struct SharedLeaderboard::Layout
+{
+    uint32_t magic;
+    uint32_t version;
+    pthread_mutex_t mutex;
+    SharedMode modes[ModesCount];
+};
+
+namespace
+{
+
+// A writer that died holding the mutex never touched a published table, so the
+// state only has to be marked consistent again
+class WriterLock
+{
+public:
+    explicit WriterLock(pthread_mutex_t& mutex) : m_mutex(mutex)
+    {
+        int result = pthread_mutex_lock(&m_mutex);
+        if (result == EOWNERDEAD)
+        {
+            pthread_mutex_consistent(&m_mutex);
+        }
+        else if (result != 0)
+        {
+            throw std::runtime_error("Could not lock leaderboard");
+        }
+    }
+
+    ~WriterLock()
+    {
+        pthread_mutex_unlock(&m_mutex);
+    }
+
+private:
+    pthread_mutex_t& m_mutex;
+};
+
+}
+
+SharedLeaderboard::SharedLeaderboard(const QString& filePath) : m_file(filePath)
+{
+    if (!m_file.open(QIODevice::ReadWrite))
+    {
+        throw std::runtime_error("Could not open leaderboard file");
+    }
+
+    // Every open leaderboard holds a shared lock on the file until it's closed, which
+    // the kernel drops for a dead process. Getting it exclusively means nobody else
+    // has the file open, so nothing can hold or wait on the mutex stored in it; one
+    // left locked by a process from before a reboot is set up anew.
+    bool isOnlyUser = flock(m_file.handle(), LOCK_EX | LOCK_NB) == 0;
+    if (!isOnlyUser && flock(m_file.handle(), LOCK_SH) != 0)
+    {
+        throw std::runtime_error("Could not lock leaderboard file");
+    }
+
+    bool isNew = m_file.size() < static_cast<qint64>(sizeof(Layout));
+    if (isNew && !isOnlyUser)
+    {
+        throw std::runtime_error("Corrupt leaderboard file");
+    }
+    if (isNew && !m_file.resize(sizeof(Layout)))
+    {
+        throw std::runtime_error("Could not resize leaderboard file");
+    }
+    uchar* data = m_file.map(0, sizeof(Layout));
+    if (!data)
+    {
+        throw std::runtime_error("Could not map leaderboard file");
+    }
+    m_layout = reinterpret_cast<Layout*>(data);
+
+    bool isValid = !isNew && m_layout->magic == LeaderboardMagic && m_layout->version == LeaderboardVersion;
+    if (!isOnlyUser)
+    {
+        if (!isValid)
+        {
+            throw std::runtime_error("Corrupt leaderboard file");
+        }
+        return;
+    }
+    if (isValid)
+    {
+        initializeMutex();
+        recover();
+    }
+    else
+    {
+        initialize();
+        importHighscores(ColoursUsed::Five);
+        importHighscores(ColoursUsed::Seven);
+    }
+    // Another process opening the file meanwhile is alone too and only sets up the
+    // mutex again, which nobody is using yet
+    if (flock(m_file.handle(), LOCK_SH) != 0)
+    {
+        throw std::runtime_error("Could not lock leaderboard file");
+    }
+}
+
+SharedLeaderboard::~SharedLeaderboard()
+{
+    if (m_layout)
+    {
+        m_file.unmap(reinterpret_cast<uchar*>(m_layout));
+    }
+}
+
+void SharedLeaderboard::initialize()
+{
+    std::memset(static_cast<void*>(m_layout), 0, sizeof(Layout));
+    initializeMutex();
+
+    for (SharedMode& mode : m_layout->modes)
+    {
+        new (&mode.published) std::atomic<uint32_t>(0U);
+        for (SharedTable& table : mode.tables)
+        {
+            new (&table.sequence) std::atomic<uint32_t>(0U);
+            table.checksum = calculateChecksum(table);
+        }
+    }
+    m_layout->version = LeaderboardVersion;
+    m_layout->magic = LeaderboardMagic;
+    msync(m_layout, sizeof(Layout), MS_SYNC);
+}
+
+void SharedLeaderboard::initializeMutex()
+{
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+    int result = pthread_mutex_init(&m_layout->mutex, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+    if (result != 0)
+    {
+        throw std::runtime_error("Could not create leaderboard mutex");
+    }
+}
+
+void SharedLeaderboard::recover()
+{
+    // A writer cut off by a power loss can leave a sequence odd, which readers would wait on
+    // forever, and a torn table fails its checksum; fall back to the other copy
+    for (SharedMode& mode : m_layout->modes)
+    {
+        for (SharedTable& table : mode.tables)
+        {
+            uint32_t sequence = table.sequence.load(std::memory_order_relaxed);
+            if ((sequence & 1U) != 0U)
+            {
+                table.sequence.store(sequence + 1U, std::memory_order_release);
+            }
+        }
+        uint32_t published = mode.published.load(std::memory_order_acquire) & 1U;
+        if (!isTableValid(mode.tables[published]) && isTableValid(mode.tables[published ^ 1U]))
+        {
+            mode.published.store(published ^ 1U, std::memory_order_release);
+        }
+    }
+    msync(m_layout, sizeof(Layout), MS_SYNC);
+}
+
+void SharedLeaderboard::importHighscores(ColoursUsed colours)
+{
+    for (auto&& highscore : m_highscore.loadHighscores(getHighscoresFileName(colours)))
+    {
+        insert(colours, highscore.first, highscore.second);
+    }
+}
+
+bool SharedLeaderboard::insert(ColoursUsed colours, const std::string& userName, uint64_t score)
+{
+    SharedMode& mode = m_layout->modes[getModeIdx(colours)];
+    WriterLock lock {m_layout->mutex};
+
+    uint32_t published = mode.published.load(std::memory_order_acquire) & 1U;
+    const SharedTable& current = mode.tables[published];
+    SharedTable& next = mode.tables[published ^ 1U];
+
+    // Equal scores keep their order of arrival
+    uint32_t position {0U};
+    while (position < current.count && current.entries[position].score >= score)
+    {
+        ++position;
+    }
+    if (position >= Capacity)
+    {
+        return false;
+    }
+
+    uint32_t sequence = next.sequence.load(std::memory_order_relaxed) | 1U;
+    next.sequence.store(sequence, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::copy(current.entries, current.entries + position, next.entries);
+    SharedEntry& entry = next.entries[position];
+    std::memset(entry.name, 0, NameBytes);
+    size_t nameLength = std::min<size_t>(userName.size(), NameBytes - 1U);
+    // Never cut a UTF-8 sequence in half
+    while (nameLength > 0U && nameLength < userName.size() && (static_cast<uint8_t>(userName[nameLength]) & 0xC0) == 0x80)
+    {
+        --nameLength;
+    }
+    std::memcpy(entry.name, userName.data(), nameLength);
+    entry.score = score;
+    uint32_t kept = std::min<uint32_t>(current.count, Capacity - 1U);
+    std::copy(current.entries + position, current.entries + kept, next.entries + position + 1U);
+    next.count = kept + 1U;
+    next.checksum = calculateChecksum(next);
+
+    next.sequence.store(sequence + 1U, std::memory_order_release);
+    mode.published.store(published ^ 1U, std::memory_order_release);
+    msync(m_layout, sizeof(Layout), MS_SYNC);
+    return true;
+}
+
+std::vector<std::pair<std::string, uint64_t>> SharedLeaderboard::snapshot(ColoursUsed colours) const
+{
+    SharedTable copy;
+    copyPublishedTable(m_layout->modes[getModeIdx(colours)], copy);
+    return getHighscores(copy);
+}
+
+bool SharedLeaderboard::readFile(const QString& filePath, ColoursUsed colours,
+                                 std::vector<std::pair<std::string, uint64_t>>& highscores)
+{
+    QFile file {filePath};
+    if (!file.open(QIODevice::ReadOnly) || file.size() != static_cast<qint64>(sizeof(Layout)))
+    {
+        return false;
+    }
+    const uchar* data = file.map(0, sizeof(Layout));
+    if (!data)
+    {
+        return false;
+    }
+    const Layout* layout = reinterpret_cast<const Layout*>(data);
+    bool isRead = layout->magic == LeaderboardMagic && layout->version == LeaderboardVersion;
+    if (isRead)
+    {
+        // Nothing may ever finish a table left odd or torn in a copied file, or before recover()
+        // runs on it, so each copy is tried once and a bad published table falls back to the other
+        const SharedMode& mode = layout->modes[getModeIdx(colours)];
+        uint32_t published = mode.published.load(std::memory_order_acquire) & 1U;
+        SharedTable copy;
+        isRead = (copyTable(mode.tables[published], copy) && isTableValid(copy)) ||
+                 (copyTable(mode.tables[published ^ 1U], copy) && isTableValid(copy));
+        if (isRead)
+        {
+            highscores = getHighscores(copy);
+        }
+    }
+    file.unmap(const_cast<uchar*>(data));
+    return isRead;
+}
+
+#else
+
+SharedLeaderboard::SharedLeaderboard(const QString& filePath) : m_file(filePath)
+{
+}
+
+SharedLeaderboard::~SharedLeaderboard()
+{
+}
+
+bool SharedLeaderboard::insert(ColoursUsed colours, const std::string& userName, uint64_t score)
+{
+    m_highscore.save(getHighscoresFileName(colours), userName, score);
+    return true;
+}
+
+std::vector<std::pair<std::string, uint64_t>> SharedLeaderboard::snapshot(ColoursUsed colours) const
+{
+    return m_highscore.loadHighscores(getHighscoresFileName(colours));
+}
+
+bool SharedLeaderboard::readFile(const QString&, ColoursUsed, std::vector<std::pair<std::string, uint64_t>>&)
+{
+    return false;
+}
+
+#endif
+
+}
@@ -0,0 +1,59 @@
+#ifndef SHAREDLEADERBOARD_H
+#define SHAREDLEADERBOARD_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <QFile>
+#include <QString>
+
+#include "gamemap.h"
+#include "highscore.h"
+
+namespace Qoolkie
+{
+
+// Top scores of every colour mode, shared by all processes on the host through a
+// memory-mapped file. Inserts are serialized by a robust process-shared mutex and
+// build the new table in a second copy before publishing it, so readers never wait
+// for a writer and a process dying mid-insert leaves the published table intact.
+// Each insert is synced to disk; a torn table is detected by its checksum, and a mutex
+// left locked by a process of an earlier boot is reset, when the file is next opened.
+// Existing JSON highscores are imported when the file is first created. Where
+// robust mutexes are not available the JSON files are used as before.
+class SharedLeaderboard
+{
+public:
+    static constexpr uint8_t Capacity {20};
+    static constexpr uint8_t NameBytes {32};
+
+    static QString getDefaultPath();
+    // One mode's table of a leaderboard file, read without opening it for inserts;
+    // false when filePath is not a leaderboard file or the table is torn
+    static bool readFile(const QString& filePath, ColoursUsed colours,
+                         std::vector<std::pair<std::string, uint64_t>>& highscores);
+
+    explicit SharedLeaderboard(const QString& filePath);
+    ~SharedLeaderboard();
+    SharedLeaderboard(const SharedLeaderboard&) = delete;
+    SharedLeaderboard& operator=(const SharedLeaderboard&) = delete;
+
+    bool insert(ColoursUsed colours, const std::string& userName, uint64_t score);
+    std::vector<std::pair<std::string, uint64_t>> snapshot(ColoursUsed colours) const;
+
+private:
+    struct Layout;
+
+    void initialize();
+    void initializeMutex();
+    void recover();
+    void importHighscores(ColoursUsed colours);
+
+    QFile m_file;
+    Layout* m_layout {nullptr};
+    Highscore m_highscore;
+};
+
+}
+
+#endif
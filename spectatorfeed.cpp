@@ -0,0 +1,325 @@
+#include "spectatorfeed.h"
+
+#include <stdexcept>
+#include <QStandardPaths>
+#include <QtGlobal>
+
+#ifdef Q_OS_LINUX
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Qoolkie
+{
+
+constexpr uint8_t SpectatorSnapshot::TilesCount;
+constexpr uint16_t SpectatorFeed::Capacity;
+
+namespace
+{
+
+constexpr char SpectatorFileName[] = "qoolkie_spectate.bin";
+
+}
+
+QString SpectatorFeed::getDefaultPath()
+{
+    // Private to the user, unlike the temp directory where anyone could plant the file first
+    QString directory = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+    if (directory.isEmpty())
+    {
+        throw std::runtime_error("No runtime directory for the spectator feed");
+    }
+    return directory + "/" + SpectatorFileName;
+}
+
+#ifdef Q_OS_LINUX
+
+namespace
+{
+
+constexpr uint32_t SpectatorMagic {0x50535143}; // "CQSP"
+constexpr uint32_t SpectatorVersion {1U};
+constexpr size_t CacheLineBytes {64U};
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Shared sequences need address-free atomics");
+
+// Opens filePath without following a symlink, accepting only a regular file of this user
+// with no other links to it, so a feed can never be pointed at some other file
+void openOwnFile(QFile& file, const QString& filePath, QIODevice::OpenMode mode)
+{
+    bool isWritable = (mode & QIODevice::WriteOnly) != 0;
+    int flags = (isWritable ? O_RDWR | O_CREAT : O_RDONLY) | O_NOFOLLOW | O_CLOEXEC;
+    int handle = ::open(QFile::encodeName(filePath).constData(), flags, S_IRUSR | S_IWUSR);
+    if (handle < 0)
+    {
+        throw std::runtime_error("Could not open spectator feed");
+    }
+    struct stat status;
+    if (fstat(handle, &status) != 0 || !S_ISREG(status.st_mode) || status.st_uid != geteuid() || status.st_nlink != 1U)
+    {
+        ::close(handle);
+        throw std::runtime_error("Spectator feed is not a private file of this user");
+    }
+    // Whatever it was created with, only the owner may read the games published to it
+    if ((isWritable && fchmod(handle, S_IRUSR | S_IWUSR) != 0) ||
+        !file.open(handle, mode, QFileDevice::AutoCloseHandle))
+    {
+        ::close(handle);
+        throw std::runtime_error("Could not open spectator feed");
+    }
+}
+
+// Sequence 2n + 1 while event n is written into the slot, 2n + 2 once it's complete
+struct alignas(CacheLineBytes) SharedSlot
+{
+    std::atomic<uint64_t> sequence;
+    SpectatorEvent event;
+};
+
+// Odd sequence while the producer fills the copy
+struct SharedSnapshot
+{
+    std::atomic<uint32_t> sequence;
+    SpectatorSnapshot snapshot;
+};
+
+}
+
+// Viewers read snapshots[published]; the producer only ever fills the other one
+struct SpectatorLayout
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    std::atomic<uint32_t> published;
+    SharedSnapshot snapshots[2];
+    // Next event to publish, alone on its line since every viewer polls it
+    alignas(CacheLineBytes) std::atomic<uint64_t> head;
+    SharedSlot ring[SpectatorFeed::Capacity];
+};
+
+SpectatorFeed::SpectatorFeed(const QString& filePath) : m_file(filePath)
+{
+    openOwnFile(m_file, filePath, QIODevice::ReadWrite);
+    // Held until the file is closed, by this object or by the process dying
+    if (flock(m_file.handle(), LOCK_EX | LOCK_NB) != 0)
+    {
+        throw std::runtime_error("Spectator feed is already published by another game");
+    }
+
+    bool isNew = m_file.size() != static_cast<qint64>(sizeof(SpectatorLayout));
+    if (isNew && !m_file.resize(sizeof(SpectatorLayout)))
+    {
+        throw std::runtime_error("Could not resize spectator feed");
+    }
+    uchar* data = m_file.map(0, sizeof(SpectatorLayout));
+    if (!data)
+    {
+        throw std::runtime_error("Could not map spectator feed");
+    }
+    m_layout = reinterpret_cast<SpectatorLayout*>(data);
+
+    if (isNew || m_layout->magic != SpectatorMagic || m_layout->version != SpectatorVersion ||
+        m_layout->capacity != Capacity)
+    {
+        initialize();
+    }
+}
+
+SpectatorFeed::~SpectatorFeed()
+{
+    if (m_layout)
+    {
+        m_file.unmap(reinterpret_cast<uchar*>(m_layout));
+    }
+}
+
+void SpectatorFeed::initialize()
+{
+    std::memset(static_cast<void*>(m_layout), 0, sizeof(SpectatorLayout));
+
+    new (&m_layout->published) std::atomic<uint32_t>(0U);
+    for (SharedSnapshot& copy : m_layout->snapshots)
+    {
+        new (&copy.sequence) std::atomic<uint32_t>(0U);
+        copy.snapshot.tiles.fill(TileContent::None);
+    }
+    new (&m_layout->head) std::atomic<uint64_t>(0U);
+    for (SharedSlot& slot : m_layout->ring)
+    {
+        new (&slot.sequence) std::atomic<uint64_t>(0U);
+    }
+    m_layout->capacity = Capacity;
+    m_layout->version = SpectatorVersion;
+    m_layout->magic = SpectatorMagic;
+}
+
+void SpectatorFeed::publish(SpectatorEventKind kind, const TurnDiff& turn, uint32_t score, uint32_t turns,
+                            ColoursUsed colours, bool isGameOver, const GameMap& map)
+{
+    uint64_t sequence = m_layout->head.load(std::memory_order_relaxed);
+    SharedSlot& slot = m_layout->ring[sequence % Capacity];
+    slot.sequence.store(2U * sequence + 1U, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    SpectatorEvent& event = slot.event;
+    event.sequence = sequence;
+    event.score = score;
+    event.turns = turns;
+    event.kind = kind;
+    event.colours = colours;
+    event.isGameOver = isGameOver;
+    event.changesCount = turn.changesCount;
+    for (uint8_t i = 0U; i < turn.changesCount; ++i)
+    {
+        // An undone turn is replayed backwards, so viewers always apply the after content
+        if (kind == SpectatorEventKind::Undo)
+        {
+            const CellChange& change = turn.changes[turn.changesCount - 1U - i];
+            event.changes[i] = CellChange {change.row, change.col, change.after, change.before};
+        }
+        else
+        {
+            event.changes[i] = turn.changes[i];
+        }
+    }
+
+    slot.sequence.store(2U * sequence + 2U, std::memory_order_release);
+    m_layout->head.store(sequence + 1U, std::memory_order_release);
+
+    uint32_t published = m_layout->published.load(std::memory_order_relaxed) & 1U;
+    SharedSnapshot& next = m_layout->snapshots[published ^ 1U];
+    uint32_t snapshotSequence = next.sequence.load(std::memory_order_relaxed) | 1U;
+    next.sequence.store(snapshotSequence, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    next.snapshot.sequence = sequence + 1U;
+    next.snapshot.score = score;
+    next.snapshot.turns = turns;
+    next.snapshot.colours = colours;
+    next.snapshot.isGameOver = isGameOver;
+    for (uint8_t i = 0U; i < GameMap::Rules::BoardSize; ++i)
+    {
+        for (uint8_t j = 0U; j < GameMap::Rules::BoardSize; ++j)
+        {
+            next.snapshot.tiles[i * GameMap::Rules::BoardSize + j] = map.getTileContent(i + 1, j + 1);
+        }
+    }
+
+    next.sequence.store(snapshotSequence + 1U, std::memory_order_release);
+    m_layout->published.store(published ^ 1U, std::memory_order_release);
+}
+
+SpectatorView::SpectatorView(const QString& filePath) : m_file(filePath)
+{
+    openOwnFile(m_file, filePath, QIODevice::ReadOnly);
+    if (m_file.size() != static_cast<qint64>(sizeof(SpectatorLayout)))
+    {
+        throw std::runtime_error("Not a spectator feed");
+    }
+    const uchar* data = m_file.map(0, sizeof(SpectatorLayout));
+    if (!data)
+    {
+        throw std::runtime_error("Could not map spectator feed");
+    }
+    m_layout = reinterpret_cast<const SpectatorLayout*>(data);
+    if (m_layout->magic != SpectatorMagic || m_layout->version != SpectatorVersion ||
+        m_layout->capacity != SpectatorFeed::Capacity)
+    {
+        throw std::runtime_error("Not a spectator feed");
+    }
+}
+
+SpectatorView::~SpectatorView()
+{
+    if (m_layout)
+    {
+        m_file.unmap(const_cast<uchar*>(reinterpret_cast<const uchar*>(m_layout)));
+    }
+}
+
+SpectatorSnapshot SpectatorView::snapshot() const
+{
+    SpectatorSnapshot copy;
+    for (;;)
+    {
+        // Only retried if two turns are published while this copy is being taken
+        const SharedSnapshot& shared = m_layout->snapshots[m_layout->published.load(std::memory_order_acquire) & 1U];
+        uint32_t sequence = shared.sequence.load(std::memory_order_acquire);
+        if ((sequence & 1U) != 0U)
+        {
+            continue;
+        }
+        std::memcpy(static_cast<void*>(&copy), &shared.snapshot, sizeof(copy));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (shared.sequence.load(std::memory_order_relaxed) == sequence)
+        {
+            return copy;
+        }
+    }
+}
+
+SpectatorRead SpectatorView::read(uint64_t sequence, SpectatorEvent& event) const
+{
+    if (sequence >= m_layout->head.load(std::memory_order_acquire))
+    {
+        return SpectatorRead::Pending;
+    }
+    const SharedSlot& slot = m_layout->ring[sequence % SpectatorFeed::Capacity];
+    uint64_t slotSequence = slot.sequence.load(std::memory_order_acquire);
+    if (slotSequence != 2U * sequence + 2U)
+    {
+        return SpectatorRead::Lapped;
+    }
+    std::memcpy(static_cast<void*>(&event), &slot.event, sizeof(event));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // The producer may have started on the slot's next lap during the copy
+    return slot.sequence.load(std::memory_order_relaxed) == slotSequence ? SpectatorRead::Ready : SpectatorRead::Lapped;
+}
+
+#else
+
+SpectatorFeed::SpectatorFeed(const QString& filePath) : m_file(filePath)
+{
+}
+
+SpectatorFeed::~SpectatorFeed()
+{
+}
+
+void SpectatorFeed::initialize()
+{
+}
+
+void SpectatorFeed::publish(SpectatorEventKind, const TurnDiff&, uint32_t, uint32_t, ColoursUsed, bool, const GameMap&)
+{
+}
+
+SpectatorView::SpectatorView(const QString& filePath) : m_file(filePath)
+{
+    throw std::runtime_error("Spectator feeds are not supported on this platform");
+}
+
+SpectatorView::~SpectatorView()
+{
+}
+
+SpectatorSnapshot SpectatorView::snapshot() const
+{
+    return SpectatorSnapshot {};
+}
+
+SpectatorRead SpectatorView::read(uint64_t, SpectatorEvent&) const
+{
+    return SpectatorRead::Pending;
+}
+
+#endif
+
+}
@@ -0,0 +1,117 @@
+#ifndef SPECTATORFEED_H
+#define SPECTATORFEED_H
+
+#include <cstdint>
+#include <array>
+#include <QFile>
+#include <QString>
+
+#include "gamemap.h"
+#include "turnhistory.h"
+
+namespace Qoolkie
+{
+
+enum class SpectatorEventKind : uint8_t
+{
+    // A new game; changes hold its first spawns, to be applied to an emptied board
+    Start,
+    // A move: the ball leaving and reaching its tiles, then clears and spawns
+    Turn,
+    Undo,
+    Redo
+};
+
+// One published turn. For a Start the viewer clears its board first, since the
+// changes only hold the new game's spawns; for every other kind applying each
+// change's after content in order brings a board at the previous sequence to this one.
+struct SpectatorEvent
+{
+    uint64_t sequence;
+    uint32_t score;
+    uint32_t turns;
+    SpectatorEventKind kind;
+    ColoursUsed colours;
+    bool isGameOver;
+    uint8_t changesCount;
+    std::array<CellChange, TurnDiff::MaxChanges> changes;
+};
+
+// The board once every event before sequence is applied, tiles row by row
+struct SpectatorSnapshot
+{
+    static constexpr uint8_t TilesCount {GameMap::Rules::BoardSize * GameMap::Rules::BoardSize};
+
+    uint64_t sequence;
+    uint32_t score;
+    uint32_t turns;
+    ColoursUsed colours;
+    bool isGameOver;
+    std::array<TileContent, TilesCount> tiles;
+};
+
+// Shared by a feed and its viewers, defined in spectatorfeed.cpp
+struct SpectatorLayout;
+
+// Producer side of a live game's spectator feed: a ring of the latest events plus a
+// snapshot for late joiners, in a memory-mapped file viewers only ever map read-only.
+// Publishing is a fixed-size copy that never waits on or even looks at the viewers,
+// so the player's turn costs the same however many are watching. One producer per
+// file, held by a lock for as long as the feed is open; sequences carry on from a
+// previous producer of the same file. Feeds and viewers only open a regular file of
+// the current user, never through a symlink, and keep it owner-only. Where shared
+// mappings are not available the feed only drops its events.
+class SpectatorFeed
+{
+public:
+    static constexpr uint16_t Capacity {1024};
+
+    // In the user's runtime directory; throws when there is none
+    static QString getDefaultPath();
+
+    explicit SpectatorFeed(const QString& filePath);
+    ~SpectatorFeed();
+    SpectatorFeed(const SpectatorFeed&) = delete;
+    SpectatorFeed& operator=(const SpectatorFeed&) = delete;
+
+    void publish(SpectatorEventKind kind, const TurnDiff& turn, uint32_t score, uint32_t turns,
+                 ColoursUsed colours, bool isGameOver, const GameMap& map);
+
+private:
+    void initialize();
+
+    QFile m_file;
+    SpectatorLayout* m_layout {nullptr};
+};
+
+enum class SpectatorRead : uint8_t
+{
+    Ready,
+    // Not published yet
+    Pending,
+    // Overwritten before it was read, resume from a fresh snapshot
+    Lapped
+};
+
+// Viewer side of a SpectatorFeed. Every viewer keeps its own position and reads at
+// its own pace; one falling more than Capacity events behind is told so instead of
+// holding the producer back.
+class SpectatorView
+{
+public:
+    explicit SpectatorView(const QString& filePath);
+    ~SpectatorView();
+    SpectatorView(const SpectatorView&) = delete;
+    SpectatorView& operator=(const SpectatorView&) = delete;
+
+    SpectatorSnapshot snapshot() const;
+    SpectatorRead read(uint64_t sequence, SpectatorEvent& event) const;
+
+private:
+    QFile m_file;
+    const SpectatorLayout* m_layout {nullptr};
+};
+
+}
+
+#endif
@@ -0,0 +1,210 @@
+#include "tournament.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <QFile>
+#include <QTextStream>
+
+#include "game.h"
+
+namespace Qoolkie
+{
+
+namespace
+{
+
+struct GameOutcome
+{
+    uint32_t score;
+    uint32_t moves;
+};
+
+// Seeds the player's own stream apart from the spawn stream of the same game
+constexpr uint64_t PlayerSeedSalt {0xA5A5A5A55A5A5A5AULL};
+
+GameOutcome playGame(Game& game, Player& player, const TournamentConfig& config, uint64_t seed)
+{
+    game.start(config.colours, seed);
+    Rng rng {seed ^ PlayerSeedSalt};
+    GameOutcome outcome {0U, 0U};
+    Move move;
+    while (!game.isGameOver() && outcome.moves < config.maxMoves && player.chooseMove(game.getMap(), rng, move))
+    {
+        if (!game.moveBall(move.fromRow, move.fromCol, move.destRow, move.destCol))
+        {
+            break;
+        }
+        ++outcome.moves;
+    }
+    outcome.score = game.getScore();
+    // Games cut short by the move limit or a player giving up never reach gameOver
+    if (config.statistics && !game.isGameOver())
+    {
+        config.statistics->recordGameOver(outcome.score, outcome.moves);
+    }
+    return outcome;
+}
+
+double mean(const std::vector<double>& values)
+{
+    double sum {0.0};
+    for (double value : values)
+    {
+        sum += value;
+    }
+    return values.empty() ? 0.0 : sum / values.size();
+}
+
+double ci95(const std::vector<double>& values, double average)
+{
+    if (values.size() < 2)
+    {
+        return 0.0;
+    }
+    double squares {0.0};
+    for (double value : values)
+    {
+        squares += (value - average) * (value - average);
+    }
+    double stddev = std::sqrt(squares / (values.size() - 1));
+    return 1.96 * stddev / std::sqrt(static_cast<double>(values.size()));
+}
+
+double percentile(std::vector<double> values, double p)
+{
+    if (values.empty())
+    {
+        return 0.0;
+    }
+    size_t rank = static_cast<size_t>(std::ceil(p * values.size()));
+    rank = std::min(std::max<size_t>(rank, 1U), values.size()) - 1;
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+}
+
+}
+
+void Tournament::addStrategy(PlayerFactory factory)
+{
+    m_factories.push_back(std::move(factory));
+}
+
+std::vector<StrategyReport> Tournament::run(const TournamentConfig& config) const
+{
+    const size_t strategies = m_factories.size();
+    const uint32_t games = config.gamesPerStrategy;
+    std::vector<GameOutcome> outcomes(strategies * games);
+    std::atomic<size_t> nextJob {0U};
+
+    auto worker = [&]()
+    {
+        Game game;
+        game.setStatistics(config.statistics);
+        std::vector<std::unique_ptr<Player>> players(strategies);
+        for (size_t job = nextJob++; job < outcomes.size(); job = nextJob++)
+        {
+            size_t strategy = job / games;
+            if (!players[strategy])
+            {
+                players[strategy] = m_factories[strategy]();
+            }
+            outcomes[job] = playGame(game, *players[strategy], config, config.baseSeed + job % games);
+        }
+    };
+
+    unsigned threadsCount = config.threadsCount != 0U ? config.threadsCount : std::max(1U, std::thread::hardware_concurrency());
+    std::vector<std::thread> threads;
+    for (unsigned i = 0U; i < threadsCount; ++i)
+    {
+        threads.emplace_back(worker);
+    }
+    for (auto&& thread : threads)
+    {
+        thread.join();
+    }
+
+    std::vector<StrategyReport> reports;
+    std::vector<double> baseline;
+    for (size_t strategy = 0U; strategy < strategies; ++strategy)
+    {
+        std::vector<double> scores(games);
+        std::vector<double> differences(games);
+        double moves {0.0};
+        for (uint32_t i = 0U; i < games; ++i)
+        {
+            const GameOutcome& outcome = outcomes[strategy * games + i];
+            scores[i] = outcome.score;
+            moves += outcome.moves;
+        }
+        if (strategy == 0U)
+        {
+            baseline = scores;
+        }
+        for (uint32_t i = 0U; i < games; ++i)
+        {
+            differences[i] = scores[i] - baseline[i];
+        }
+
+        StrategyReport report;
+        report.name = m_factories[strategy]()->getName();
+        report.games = games;
+        report.meanScore = mean(scores);
+        report.scoreCi95 = ci95(scores, report.meanScore);
+        report.p10Score = percentile(scores, 0.1);
+        report.p50Score = percentile(scores, 0.5);
+        report.p90Score = percentile(scores, 0.9);
+        report.meanMoves = games != 0U ? moves / games : 0.0;
+        report.meanDifference = mean(differences);
+        report.differenceCi95 = ci95(differences, report.meanDifference);
+        reports.push_back(report);
+    }
+    return reports;
+}
+
+int runTournament(uint32_t gamesPerStrategy, uint64_t baseSeed, ColoursUsed colours, const QString& statisticsPrefix)
+{
+    Tournament tournament;
+    tournament.addStrategy([]() { return std::unique_ptr<Player>(new RandomPlayer()); });
+    tournament.addStrategy([]() { return std::unique_ptr<Player>(new GreedyPlayer()); });
+    tournament.addStrategy([]() { return std::unique_ptr<Player>(new PotentialPlayer()); });
+
+    TournamentConfig config;
+    config.gamesPerStrategy = gamesPerStrategy;
+    config.baseSeed = baseSeed;
+    config.colours = colours;
+    GameStatistics statistics;
+    if (!statisticsPrefix.isEmpty())
+    {
+        config.statistics = &statistics;
+    }
+
+    QTextStream out(stdout);
+    out << "strategy\tgames\tmean\t+-95%\tp10\tp50\tp90\tmoves\tvs first\t+-95%" << endl;
+    for (auto&& report : tournament.run(config))
+    {
+        out << QString::fromStdString(report.name) << '\t' << report.games << '\t'
+            << report.meanScore << '\t' << report.scoreCi95 << '\t'
+            << report.p10Score << '\t' << report.p50Score << '\t' << report.p90Score << '\t'
+            << report.meanMoves << '\t' << report.meanDifference << '\t' << report.differenceCi95 << endl;
+    }
+
+    if (config.statistics)
+    {
+        StatisticsSnapshot snapshot = statistics.snapshot();
+        QFile binaryFile {statisticsPrefix + ".bin"};
+        QFile csvFile {statisticsPrefix + ".csv"};
+        if (!binaryFile.open(QIODevice::WriteOnly) || !csvFile.open(QIODevice::WriteOnly | QIODevice::Text))
+        {
+            out << "Could not write statistics to " << statisticsPrefix << endl;
+            return 1;
+        }
+        snapshot.writeBinary(binaryFile);
+        snapshot.writeCsv(csvFile);
+        out << "Statistics of " << snapshot.games << " games written to " << statisticsPrefix << ".bin/.csv" << endl;
+    }
+    return 0;
+}
+
+}
@@ -0,0 +1,61 @@
+#ifndef TOURNAMENT_H
+#define TOURNAMENT_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <QString>
+
+#include "gamemap.h"
+#include "gamestatistics.h"
+#include "player.h"
+
+namespace Qoolkie
+{
+
+struct TournamentConfig
+{
+    uint32_t gamesPerStrategy {1000U};
+    uint64_t baseSeed {1U};
+    ColoursUsed colours {ColoursUsed::Five};
+    uint32_t maxMoves {10000U};
+    unsigned threadsCount {0U};
+    GameStatistics* statistics {nullptr};
+};
+
+struct StrategyReport
+{
+    std::string name;
+    uint32_t games;
+    double meanScore;
+    double scoreCi95;
+    double p10Score;
+    double p50Score;
+    double p90Score;
+    double meanMoves;
+    // Paired against the first strategy on the same seeds
+    double meanDifference;
+    double differenceCi95;
+};
+
+// Plays every strategy on the same fixed seeds, spreading the games over all cores.
+// Game i uses seed baseSeed + i for every strategy, so results can be compared pairwise.
+class Tournament
+{
+public:
+    using PlayerFactory = std::function<std::unique_ptr<Player>()>;
+
+    void addStrategy(PlayerFactory factory);
+    std::vector<StrategyReport> run(const TournamentConfig& config) const;
+
+private:
+    std::vector<PlayerFactory> m_factories;
+};
+
+int runTournament(uint32_t gamesPerStrategy, uint64_t baseSeed, ColoursUsed colours, const QString& statisticsPrefix);
+
+}
+
+#endif
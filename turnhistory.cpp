@@ -0,0 +1,91 @@
+#include "turnhistory.h"
+
+namespace Qoolkie
+{
+
+constexpr uint8_t TurnDiff::MaxChanges;
+constexpr uint16_t TurnHistory::Capacity;
+
+void TurnDiff::addChange(uint8_t row, uint8_t col, TileContent before, TileContent after) noexcept
+{
+    if (changesCount < MaxChanges)
+    {
+        changes[changesCount++] = CellChange {row, col, before, after};
+    }
+}
+
+void TurnDiff::undo(GameMap& map) const
+{
+    for (uint8_t i = changesCount; i > 0U; --i)
+    {
+        const CellChange& change = changes[i - 1];
+        map.setTileContent(change.row, change.col, change.before);
+    }
+}
+
+void TurnDiff::redo(GameMap& map) const
+{
+    for (uint8_t i = 0U; i < changesCount; ++i)
+    {
+        const CellChange& change = changes[i];
+        map.setTileContent(change.row, change.col, change.after);
+    }
+}
+
+TurnHistory::TurnHistory() : m_turns(Capacity)
+{
+}
+
+TurnDiff& TurnHistory::beginTurn() noexcept
+{
+    TurnDiff& turn = m_turns[m_next];
+    turn.changesCount = 0U;
+    m_next = (m_next + 1U) % Capacity;
+    m_undoCount = m_undoCount < Capacity ? m_undoCount + 1U : Capacity;
+    m_redoCount = 0U;
+    return turn;
+}
+
+const TurnDiff* TurnHistory::undo() noexcept
+{
+    if (m_undoCount == 0U)
+    {
+        return nullptr;
+    }
+    m_next = (m_next + Capacity - 1U) % Capacity;
+    --m_undoCount;
+    ++m_redoCount;
+    return &m_turns[m_next];
+}
+
+const TurnDiff* TurnHistory::redo() noexcept
+{
+    if (m_redoCount == 0U)
+    {
+        return nullptr;
+    }
+    const TurnDiff* turn = &m_turns[m_next];
+    m_next = (m_next + 1U) % Capacity;
+    --m_redoCount;
+    ++m_undoCount;
+    return turn;
+}
+
+bool TurnHistory::canUndo() const noexcept
+{
+    return m_undoCount != 0U;
+}
+
+bool TurnHistory::canRedo() const noexcept
+{
+    return m_redoCount != 0U;
+}
+
+void TurnHistory::clear() noexcept
+{
+    m_next = 0U;
+    m_undoCount = 0U;
+    m_redoCount = 0U;
+}
+
+}
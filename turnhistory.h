@@ -0,0 +1,68 @@
+#ifndef TURNHISTORY_H
+#define TURNHISTORY_H
+
+#include <cstdint>
+#include <array>
+#include <vector>
+
+#include "gamemap.h"
+
+namespace Qoolkie
+{
+
+struct CellChange
+{
+    uint8_t row;
+    uint8_t col;
+    TileContent before;
+    TileContent after;
+};
+
+// Everything one turn changed, in the order it happened: the moved ball, spawned
+// balls and cleared lines, plus the score and RNG position around the turn. Cells
+// use 1-based map coordinates. Applying it either way only touches changed cells.
+struct TurnDiff
+{
+    // Moved ball (2 cells) and the line it clears, or every spawned ball plus a line through each
+    static constexpr uint8_t MaxChanges {2U + GameMap::Rules::SpawnsPerTurn * (1U + GameMap::Rules::BoardSize)};
+
+    std::array<CellChange, MaxChanges> changes;
+    uint8_t changesCount {0U};
+    uint32_t scoreBefore {0U};
+    uint32_t scoreAfter {0U};
+    uint64_t rngBefore {0U};
+    uint64_t rngAfter {0U};
+    bool wasGameOver {false};
+    bool isGameOver {false};
+
+    void addChange(uint8_t row, uint8_t col, TileContent before, TileContent after) noexcept;
+    void undo(GameMap& map) const;
+    void redo(GameMap& map) const;
+};
+
+// Fixed-size ring of the latest turns. Recording a turn drops whatever could be
+// redone and, once the ring is full, the oldest turn, so memory never grows.
+class TurnHistory
+{
+public:
+    static constexpr uint16_t Capacity {256};
+
+    TurnHistory();
+
+    TurnDiff& beginTurn() noexcept;
+    const TurnDiff* undo() noexcept;
+    const TurnDiff* redo() noexcept;
+    bool canUndo() const noexcept;
+    bool canRedo() const noexcept;
+    void clear() noexcept;
+
+private:
+    std::vector<TurnDiff> m_turns;
+    uint16_t m_next {0U};
+    uint16_t m_undoCount {0U};
+    uint16_t m_redoCount {0U};
+};
+
+}
+
+#endif